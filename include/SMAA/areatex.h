@@ -3,10 +3,15 @@
 #include <array>
 
 #include "ibuffer.h"
+#include "SMAA/lut.h"
 
 #define AREATEX_WIDTH 160
 #define AREATEX_HEIGHT 560
 #define AREATEX_PITCH (AREATEX_WIDTH * 2)
 #define AREATEX_SIZE (AREATEX_HEIGHT * AREATEX_PITCH)
 
+// packed 8-bit texture, used by default
+extern lut8<2> area_lut;
+
+// float reference texture, used to validate the packed one
 extern fbuffer2 area_buffer;
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "vec.h"
+
+// read-only lookup texture kept in its original packed 8-bit (UNORM) form. Mirrors the part of the
+// ibuffer sampling interface that SMAA uses, but normalizes each channel to [0, 1] on the fly,
+// which keeps the textures at a quarter of the size of their float counterparts
+template <size_t depth> class lut8 {
+public:
+  typedef vec<float, depth> pixel;
+  typedef long long int pos_t;
+
+private:
+  // signed like the positions they're compared against
+  const pos_t width;
+  const pos_t height;
+  const float2 dim;
+
+  std::vector<unsigned char> texels;
+
+  inline unsigned char const* texel(pos_t x, pos_t y) const {
+    return &texels[(y * width + x) * depth];
+  }
+
+public:
+  template <typename Iterator>
+  lut8(size_t width, size_t height, Iterator begin, Iterator end)
+      : width((pos_t)width), height((pos_t)height), dim((float)width, (float)height),
+        texels(begin, end) {
+    if (texels.size() != width * height * depth) {
+      throw std::invalid_argument{"trying to initialize lut8 from an iterable whose length "
+                                  "differs from width * height * depth"};
+    }
+  }
+
+  pixel get_or_def(pos_t x, pos_t y) const {
+    pixel p(0.0f);
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+      return p;
+    }
+
+    unsigned char const* t = texel(x, y);
+    unroll<depth>([&](auto i) { p[i] = t[i] * (1.0f / 255.0f); });
+    return p;
+  }
+
+  pixel get_bilinear_def(float x, float y) const {
+    float cx = std::floor(x);
+    float cy = std::floor(y);
+
+    float tx = x - cx;
+    float ty = y - cy;
+
+    pos_t ix = cx;
+    pos_t iy = cy;
+
+    // lands exactly on a texel, so this is just an indexed lookup
+    if (tx == 0.0f && ty == 0.0f) {
+      return get_or_def(ix, iy);
+    }
+
+    // all four texels are inside of the texture, filter the raw bytes directly
+    if (ix >= 0 && iy >= 0 && ix + 1 < width && iy + 1 < height) {
+      unsigned char const* tl = texel(ix, iy);
+      unsigned char const* bl = tl + width * depth;
+
+      pixel p;
+      unroll<depth>([&](auto i) {
+        float top = (tl[i + depth] - tl[i]) * tx + tl[i];
+        float bottom = (bl[i + depth] - bl[i]) * tx + bl[i];
+        p[i] = ((bottom - top) * ty + top) * (1.0f / 255.0f);
+      });
+      return p;
+    }
+
+    pixel Ptl = get_or_def(ix, iy);
+    pixel Ptr = get_or_def(ix + 1, iy);
+    pixel Pbl = get_or_def(ix, iy + 1);
+    pixel Pbr = get_or_def(ix + 1, iy + 1);
+
+    return pixel::lerp(ty, pixel::lerp(tx, Ptl, Ptr), pixel::lerp(tx, Pbl, Pbr));
+  }
+
+  float2 from_norm_coords(float2 coords) const { return coords * dim; }
+
+  inline size_t get_width() const { return (size_t)width; }
+
+  inline size_t get_height() const { return (size_t)height; }
+
+  // size of the texture in memory, in bytes
+  inline size_t get_footprint() const { return texels.size(); }
+};
@@ -3,10 +3,15 @@
 #include <array>
 
 #include "ibuffer.h"
+#include "SMAA/lut.h"
 
 #define SEARCHTEX_WIDTH 64
 #define SEARCHTEX_HEIGHT 16
 #define SEARCHTEX_PITCH SEARCHTEX_WIDTH
 #define SEARCHTEX_SIZE (SEARCHTEX_HEIGHT * SEARCHTEX_PITCH)
 
+// packed 8-bit texture, used by default
+extern lut8<1> search_lut;
+
+// float reference texture, used to validate the packed one
 extern fbuffer1 search_buffer;
\ No newline at end of file
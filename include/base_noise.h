@@ -0,0 +1,124 @@
+#pragma once
+
+#include "lattice3.h"
+#include "vector3.h"
+#include "worley.h"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// single octaves of the noises that Perlin and Fractal sum over, each one evaluated a row of pixels
+// at a time. Every octave is built from the lattice3 that gives its cellsize, loops and seed, and
+// has the same interface:
+//
+//   framewise             true if prepare keeps state for a single frame. Otherwise prepare does
+//                         nothing, and rows of different frames may be computed concurrently
+//   prepare(z)            called before the rows of a frame at z (in pixels) are computed, not
+//                         thread-safe
+//   row(y, z, values[])   noise of every pixel of row y of the frame at z, about in [-1, 1]. Rows
+//                         of a frame may be computed concurrently once prepare(z) returned
+//
+// Anything that is the same on every row (e.g., the cell of every column) is computed once on
+// construction, anything that is the same on every pixel of a row (e.g., the corner gradients)
+// once per row.
+
+enum BASE_NOISE {
+  BASE_PERLIN=0,
+  BASE_VALUE,
+  BASE_WORLEY,
+  BASE_SIMPLEX,
+
+  BASE_NOISE_LAST
+};
+
+extern const char* BASE_NOISE_NAMES[4];
+
+// Perlin (gradient) noise, see perlin.lua
+class gradient_octave {
+  lattice3 ltc;
+  bool threed;
+  std::vector<long long> xcells; // cell of every column
+
+public:
+  gradient_octave(lattice3 const& ltc, size_t width, bool threed);
+
+  inline lattice3 const& get_lattice() const { return ltc; }
+
+  static constexpr bool framewise = false;
+  inline void prepare(double) {}
+  void row(double y, double z, double values[]) const;
+};
+
+// value noise, a random value per corner, interpolated the same way as the gradients
+class value_octave {
+  lattice3 ltc;
+  bool threed;
+  std::vector<long long> xcells;
+
+public:
+  value_octave(lattice3 const& ltc, size_t width, bool threed);
+
+  inline lattice3 const& get_lattice() const { return ltc; }
+
+  static constexpr bool framewise = false;
+  inline void prepare(double) {}
+  void row(double y, double z, double values[]) const;
+};
+
+// distance to the closest Worley point, in cells and mapped from [0, 1] to [-1, 1]. Uses the same
+// cell caches as Worley, the periodic one if the octave loops along every axis
+class worley_octave {
+  lattice3 ltc;
+  std::vector<long long> xcells;
+
+  // only one of them is used
+  std::unique_ptr<Worley::cache_t> cache;
+  std::unique_ptr<Worley::periodic_cache_t> periodic_cache;
+
+  // set by prepare for the current frame
+  Worley::points_t const* slabs[3] = {};
+  double zcorners[3] = {};
+
+  template <typename F> decltype(auto) with_cache(F&& f) const {
+    return periodic_cache ? f(*periodic_cache) : f(*cache);
+  }
+
+public:
+  worley_octave(lattice3 const& ltc, size_t width, size_t height, double mean_points);
+
+  inline lattice3 const& get_lattice() const { return ltc; }
+
+  static constexpr bool framewise = true;
+  void prepare(double z);
+  void row(double y, double z, double values[]) const;
+};
+
+// simplex noise, gradients at the 3 corners of a triangle (2D) or the 4 corners of a tetrahedron
+// (3D) around every pixel, rather than the 4 or 8 corners of a square or cube. Uses the lattices
+// of psrdnoise (Gustavson & McEwan, 2022), which repeat after any whole number of cells along x and
+// z, and an even number of rows along y in 2D, so that it loops the same way as gradient_octave.
+// A 2D octave that loops after an odd number of cells along y is stretched by one row to fit.
+//
+// Since gradient_octave already looks its corners up once per row, this is only cheaper than it
+// for small cells, about the same overall, see tests/scripts/bench_simplex1.lua
+class simplex_octave {
+  lattice3 ltc;
+  lattice3 corners; // seeds of the corners, by their position in half cells
+  bool threed;
+  size_t width;
+  double ystretch = 1; // rows of the 2D lattice per cell along y
+
+  void row2(double y, double values[]) const;
+  void row3(double y, double z, double values[]) const;
+
+public:
+  simplex_octave(lattice3 const& ltc, size_t width, bool threed);
+
+  inline lattice3 const& get_lattice() const { return ltc; }
+
+  static constexpr bool framewise = false;
+  inline void prepare(double) {}
+  void row(double y, double z, double values[]) const;
+};
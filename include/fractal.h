@@ -0,0 +1,90 @@
+#pragma once
+
+#include "base_noise.h"
+#include "common.h"
+#include "larray.h"
+#include "vector3.h"
+
+#include <string>
+#include <vector>
+
+enum FRACTAL_TYPE {
+  FRACTAL_FBM=0,    // sum of amplitude * noise
+  FRACTAL_RIDGED,   // sum of amplitude * (1 - |noise|)^2, sharp ridges where the noise crosses 0
+  FRACTAL_TURBULENCE, // sum of amplitude * |noise|, creases where the noise crosses 0
+
+  FRACTAL_TYPE_LAST
+};
+
+extern const char* FRACTAL_TYPE_NAMES[3];
+
+// sums octaves of any of the base noises (see base_noise.h), where every octave has lacunarity
+// times the frequency and gain times the amplitude of the previous one. This is the engine behind
+// both Fractal and Perlin (fBm of gradient octaves with lacunarity 2 and gain 0.5), which only
+// differ in the options they read from Lua.
+//
+// Octaves loop after loops * lacunarity^i cells, rounded to whole cells, so looping noise only
+// tiles seamlessly for whole lacunarities. Octaves whose lattice loops along every axis share
+// their Worley cells across frames, see Worley::periodic_cache_t.
+struct fractal_engine {
+  int seed = 0;
+  double width = 0;       // width: double -- width in pixels
+  double height = 0;      // height: double -- height in pixels
+  int length = 1;         // length: int -- length in frames
+  double cellsize = 1;    // cellsize: double -- size of each cell of the first octave in pixels
+  int octaves = 4;        // octaves: int -- number of octaves to sum
+  double lacunarity = 2;  // lacunarity: double -- frequency multiplier between octaves
+  double gain = 0.5;      // gain: double -- amplitude multiplier between octaves
+  FRACTAL_TYPE fractal = FRACTAL_FBM; // fractal: enum -- how octaves are combined
+  BASE_NOISE base = BASE_PERLIN;      // base: enum -- noise of every octave
+  int dimensions = 2;     // dimensions: int -- 2 for still noise, 3 to move through z over frames
+  double movement = 0;    // movement: double -- how far to move along z over the length, in cells
+  double mean_points = 1; // mean_points: double -- mean number of points per cell, Worley only
+  dvec3 freq;             // loops: table -- after how many cells of the first octave to loop
+  ARRAY_TYPE array_type =
+      ARRAY_DOUBLE; // array_type: enum -- element type of the returned larrays
+
+  // octaves of the base noise, Octave is one of the octave classes of base_noise.h
+  template <typename Octave> std::vector<Octave> make_octaves() const;
+
+  // amplitude of every octave, starting at 1
+  std::vector<double> get_amplitudes() const;
+
+  // combines every octave of row y of the frame at z (in pixels) into values, normalized by the
+  // sum of the amplitudes
+  template <typename Octave>
+  void compute_row(std::vector<Octave> const& octs, std::vector<double> const& amplitudes,
+                   double y, double z, double values[]) const;
+
+  // reads the options that Fractal and Perlin share from the table at stack index idx, leaving
+  // the others as they are. name is the class that errors are reported for
+  void load_options(lua_State* L, int idx, const char* name);
+
+  // computes every frame into the table at stack index into, reusing the larrays already in it
+  // where they match the result type and size, and returns it
+  template <typename Octave> int compute_frames(lua_State* L, int into) const;
+  int compute_frames(lua_State* L, int into) const;
+};
+
+// Lua class over fractal_engine, with every option of it
+class Fractal {
+  fractal_engine engine;
+
+  // reads the properties given in the table at stack index idx, leaving the others as they are
+  void load_options(lua_State* L, int idx);
+
+public:
+  std::string to_string() const;
+
+  static int lnew(lua_State* L);
+  // F:set{...}, changes any of the properties given to the constructor and returns F
+  static int set(lua_State* L);
+  // F:compute(), table of length larrays of width * height values, in about [-1, 1] for fBm and
+  // [0, 1] for ridged and turbulence
+  static int compute(lua_State* L);
+  // F:compute_into(frames), same as compute but fills (and returns) the given table of frames,
+  // which allows the larrays of a previous call to be recycled
+  static int compute_into(lua_State* L);
+  static int to_string(lua_State* L);
+  static void register_class(lua_State* L);
+};
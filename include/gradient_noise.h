@@ -0,0 +1,71 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// single octave gradient noise evaluated several points at a time, the SIMD counterpart of
+// perlin2d/perlin3d in perlin.lua. Corners get their gradient from an integer hash of the cell
+// rather than a table or trig, so that every lane can do its own lookup.
+//
+// Kernels are picked once at load time through CPUID, AVX2 (8 lanes, FMA lerps) is used where the
+// CPU has it, SSE2 (4 lanes) on any other x86-64, and the scalar reference everywhere else. Every
+// kernel gives the same result as the scalar one, up to float rounding. Defining VEC_NO_SIMD
+// leaves only the scalar kernel, same as for vec.h.
+#if !defined(VEC_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GRADIENT_SSE2 1
+#else
+#define GRADIENT_SSE2 0
+#endif
+
+// the AVX2 kernel lives in its own translation unit, built with AVX2 enabled by src/CMakeLists.txt
+#if GRADIENT_SSE2 && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#define GRADIENT_AVX2 1
+#else
+#define GRADIENT_AVX2 0
+#endif
+
+enum GRADIENT_KERNEL {
+  KERNEL_SCALAR=0,
+  KERNEL_SSE2,
+  KERNEL_AVX2,
+
+  GRADIENT_KERNEL_LAST
+};
+
+extern const char* GRADIENT_KERNEL_NAMES[3];
+
+// whether kernel was built in and can run on this CPU, KERNEL_SCALAR always can
+bool gradient_kernel_supported(GRADIENT_KERNEL kernel);
+
+// fastest kernel that gradient_kernel_supported, only checked once
+GRADIENT_KERNEL best_gradient_kernel();
+
+// out[i] = noise(x[i], y[i]) for every i < n, positions are in cells. Noise is 0 on every corner
+// and stays within about [-1, 1]. Throws std::invalid_argument if kernel isn't supported
+void gradient_noise2(GRADIENT_KERNEL kernel, uint32_t seed, float const x[], float const y[],
+                     float out[], size_t n);
+
+// out[i] = noise(x[i], y[i], z[i]) for every i < n, see gradient_noise2
+void gradient_noise3(GRADIENT_KERNEL kernel, uint32_t seed, float const x[], float const y[],
+                     float const z[], float out[], size_t n);
+
+// number of gradients in a gradient table
+constexpr size_t GRADIENT_TABLE_SIZE = 256 * 256;
+
+// GRADIENT_TABLE_SIZE random unit gradients of the given dimensions (2 or 3), stored one after the
+// other, i.e., x, y(, z), x, y(, z), ... Generated on first use, always from the same seed, and
+// shared from then on. Throws std::invalid_argument for any other dimensions
+std::vector<double> const& gradient_table(size_t dimensions);
+
+// libnoise.gradient_table(dimensions = 2), ldarray copy of gradient_table, the table Perlin noise
+// in perlin.lua looks its gradients up in
+int l_gradient_table(lua_State* L);
+
+// libnoise.gradient_noise{ seed, width, height, cellsize = 1, z = 0, dimensions = 2, kernel },
+// lfarray of width * height noise values of a single frame, z is in cells. kernel is one of
+// libnoise.GRADIENT_KERNELS and defaults to the fastest one the CPU supports
+int l_gradient_noise(lua_State* L);
@@ -0,0 +1,190 @@
+#pragma once
+
+// gradient noise kernels written once against an ops struct S, which wraps the intrinsics of a
+// single instruction set. Only meant to be included by the translation units that instantiate
+// them (gradient_noise.cc and gradient_noise_avx2.cc), since each of those is built for its own
+// instruction set. S provides:
+//
+//   width, f (float lanes), i (uint32 lanes), load, store, set1, set1i, add, sub, mul,
+//   madd(a, b, c) = a*b + c, floor, to_int, addi, andi, xori, mullo, srli<N>, slli<N>,
+//   is_zero(v) (all ones where v == 0), equals(a, b), select(mask, a, b) = mask ? a : b,
+//   flip_sign(v, bits) (xors v with bits, which only ever has the sign bit set)
+//
+// Every operation matches gradient_noise.cc's scalar reference step for step, so the only
+// difference is rounding where S fuses multiply-adds.
+
+#include "gradient_noise.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gradient_simd {
+
+// same primes as the scalar hash
+constexpr uint32_t PRIME_X = 0x9E3779B1u;
+constexpr uint32_t PRIME_Y = 0x85EBCA77u;
+constexpr uint32_t PRIME_Z = 0xC2B2AE3Du;
+
+// murmur3 finalizer of seed ^ x*PRIME_X ^ y*PRIME_Y ^ z*PRIME_Z, primed coordinates are given
+template <typename S> inline typename S::i hash(typename S::i seed, typename S::i px,
+                                                typename S::i py, typename S::i pz) {
+  typedef typename S::i I;
+  I h = S::xori(S::xori(seed, px), S::xori(py, pz));
+  h = S::xori(h, S::template srli<16>(h));
+  h = S::mullo(h, S::set1i(0x85EBCA6Bu));
+  h = S::xori(h, S::template srli<13>(h));
+  h = S::mullo(h, S::set1i(0xC2B2AE35u));
+  return S::xori(h, S::template srli<16>(h));
+}
+
+// one of (+-1, +-0.5), (+-0.5, +-1) dot (x, y)
+template <typename S>
+inline typename S::f grad2(typename S::i h, typename S::f x, typename S::f y) {
+  typedef typename S::i I;
+  I swap = S::is_zero(S::andi(h, S::set1i(4)));
+  typename S::f u = S::select(swap, x, y);
+  typename S::f v = S::select(swap, y, x);
+  u = S::flip_sign(u, S::template slli<31>(h));
+  v = S::flip_sign(v, S::template slli<30>(S::andi(h, S::set1i(2))));
+  return S::madd(S::set1(0.5f), v, u);
+}
+
+// dot product with one of the 12 edge gradients of improved Perlin noise, picked by h & 15
+template <typename S>
+inline typename S::f grad3(typename S::i h, typename S::f x, typename S::f y, typename S::f z) {
+  typedef typename S::i I;
+  typedef typename S::f F;
+  I below8 = S::is_zero(S::andi(h, S::set1i(8)));
+  I below4 = S::is_zero(S::andi(h, S::set1i(12)));
+  I twelve_or_fourteen = S::equals(S::andi(h, S::set1i(13)), S::set1i(12));
+
+  F u = S::select(below8, x, y);
+  F v = S::select(below4, y, S::select(twelve_or_fourteen, x, z));
+  u = S::flip_sign(u, S::template slli<31>(h));
+  v = S::flip_sign(v, S::template slli<30>(S::andi(h, S::set1i(2))));
+  return S::add(u, v);
+}
+
+// t*t*t*(t*(t*6 - 15) + 10), i.e., smootherstep's weight
+template <typename S> inline typename S::f fade(typename S::f t) {
+  typename S::f p = S::madd(t, S::set1(6.0f), S::set1(-15.0f));
+  p = S::madd(t, p, S::set1(10.0f));
+  return S::mul(S::mul(S::mul(t, t), t), p);
+}
+
+template <typename S>
+inline typename S::f lerp(typename S::f a, typename S::f b, typename S::f t) {
+  return S::madd(t, S::sub(b, a), a);
+}
+
+template <typename S>
+inline typename S::f noise2(typename S::i seed, typename S::f x, typename S::f y) {
+  typedef typename S::i I;
+  typedef typename S::f F;
+  F one = S::set1(1.0f);
+
+  F xf = S::floor(x), yf = S::floor(y);
+  F fx = S::sub(x, xf), fy = S::sub(y, yf);
+  F fx1 = S::sub(fx, one), fy1 = S::sub(fy, one);
+
+  I px = S::mullo(S::to_int(xf), S::set1i(PRIME_X));
+  I py = S::mullo(S::to_int(yf), S::set1i(PRIME_Y));
+  I px1 = S::addi(px, S::set1i(PRIME_X));
+  I py1 = S::addi(py, S::set1i(PRIME_Y));
+  I pz = S::set1i(0);
+
+  F n00 = grad2<S>(hash<S>(seed, px, py, pz), fx, fy);
+  F n10 = grad2<S>(hash<S>(seed, px1, py, pz), fx1, fy);
+  F n01 = grad2<S>(hash<S>(seed, px, py1, pz), fx, fy1);
+  F n11 = grad2<S>(hash<S>(seed, px1, py1, pz), fx1, fy1);
+
+  F u = fade<S>(fx), v = fade<S>(fy);
+  return lerp<S>(lerp<S>(n00, n10, u), lerp<S>(n01, n11, u), v);
+}
+
+template <typename S>
+inline typename S::f noise3(typename S::i seed, typename S::f x, typename S::f y,
+                            typename S::f z) {
+  typedef typename S::i I;
+  typedef typename S::f F;
+  F one = S::set1(1.0f);
+
+  F xf = S::floor(x), yf = S::floor(y), zf = S::floor(z);
+  F fx = S::sub(x, xf), fy = S::sub(y, yf), fz = S::sub(z, zf);
+  F fx1 = S::sub(fx, one), fy1 = S::sub(fy, one), fz1 = S::sub(fz, one);
+
+  I px = S::mullo(S::to_int(xf), S::set1i(PRIME_X));
+  I py = S::mullo(S::to_int(yf), S::set1i(PRIME_Y));
+  I pz = S::mullo(S::to_int(zf), S::set1i(PRIME_Z));
+  I px1 = S::addi(px, S::set1i(PRIME_X));
+  I py1 = S::addi(py, S::set1i(PRIME_Y));
+  I pz1 = S::addi(pz, S::set1i(PRIME_Z));
+
+  F u = fade<S>(fx), v = fade<S>(fy), w = fade<S>(fz);
+
+  // x first, then y, then z
+  F n0 = lerp<S>(lerp<S>(grad3<S>(hash<S>(seed, px, py, pz), fx, fy, fz),
+                         grad3<S>(hash<S>(seed, px1, py, pz), fx1, fy, fz), u),
+                 lerp<S>(grad3<S>(hash<S>(seed, px, py1, pz), fx, fy1, fz),
+                         grad3<S>(hash<S>(seed, px1, py1, pz), fx1, fy1, fz), u),
+                 v);
+  F n1 = lerp<S>(lerp<S>(grad3<S>(hash<S>(seed, px, py, pz1), fx, fy, fz1),
+                         grad3<S>(hash<S>(seed, px1, py, pz1), fx1, fy, fz1), u),
+                 lerp<S>(grad3<S>(hash<S>(seed, px, py1, pz1), fx, fy1, fz1),
+                         grad3<S>(hash<S>(seed, px1, py1, pz1), fx1, fy1, fz1), u),
+                 v);
+  return lerp<S>(n0, n1, w);
+}
+
+// runs the kernel over n points, the last n % S::width go through a padded block
+template <typename S>
+void noise2_n(uint32_t seed, float const x[], float const y[], float out[], size_t n) {
+  typename S::i vseed = S::set1i(seed);
+
+  size_t i = 0;
+  for (; i + S::width <= n; i += S::width)
+    S::store(out + i, noise2<S>(vseed, S::load(x + i), S::load(y + i)));
+
+  if (i < n) {
+    float bx[S::width] = {}, by[S::width] = {}, bout[S::width];
+    for (size_t j = i; j < n; j++) {
+      bx[j - i] = x[j];
+      by[j - i] = y[j];
+    }
+    S::store(bout, noise2<S>(vseed, S::load(bx), S::load(by)));
+    for (size_t j = i; j < n; j++)
+      out[j] = bout[j - i];
+  }
+}
+
+template <typename S>
+void noise3_n(uint32_t seed, float const x[], float const y[], float const z[], float out[],
+              size_t n) {
+  typename S::i vseed = S::set1i(seed);
+
+  size_t i = 0;
+  for (; i + S::width <= n; i += S::width)
+    S::store(out + i, noise3<S>(vseed, S::load(x + i), S::load(y + i), S::load(z + i)));
+
+  if (i < n) {
+    float bx[S::width] = {}, by[S::width] = {}, bz[S::width] = {}, bout[S::width];
+    for (size_t j = i; j < n; j++) {
+      bx[j - i] = x[j];
+      by[j - i] = y[j];
+      bz[j - i] = z[j];
+    }
+    S::store(bout, noise3<S>(vseed, S::load(bx), S::load(by), S::load(bz)));
+    for (size_t j = i; j < n; j++)
+      out[j] = bout[j - i];
+  }
+}
+
+#if GRADIENT_AVX2
+// defined in gradient_noise_avx2.cc, the only translation unit built with AVX2 enabled. Must only
+// be called once the CPU is known to support AVX2 and FMA
+void noise2_avx2(uint32_t seed, float const x[], float const y[], float out[], size_t n);
+void noise3_avx2(uint32_t seed, float const x[], float const y[], float const z[], float out[],
+                 size_t n);
+#endif
+
+} // namespace gradient_simd
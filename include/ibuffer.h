@@ -2,13 +2,157 @@
 
 #include <cstddef>
 #include <iterator>
+#include <new>
 #include <stdexcept>
 #include <vector>
 
+#include "thread_pool.h"
 #include "vec.h"
 #include <functional>
 
-template <typename T, size_t depth> class ibuffer {
+// storage layouts for ibuffer, picked with its third template parameter
+struct interleaved {}; // one std::vector of pixels, the channels of each pixel are adjacent (AoS)
+struct planar {};      // one aligned plane per channel, with padded rows (SoA)
+
+template <typename T, size_t depth, typename Layout = interleaved> class ibuffer;
+
+// wrap modes for ibuffer::fetch/sample, each maps a coordinate c along an axis of size n back into
+// [0, n), or returns false if the default pixel should be used instead
+struct wrap_def { // out of bounds reads give the default pixel
+  static inline bool wrap(long long& c, size_t n) { return 0 <= c && c < (long long)n; }
+};
+
+struct wrap_loop { // the buffer repeats, e.g., n -> 0, -1 -> n-1
+  static inline bool wrap(long long& c, size_t n) {
+    c %= (long long)n;
+    if (c < 0)
+      c += n;
+    return true;
+  }
+};
+
+struct wrap_clamp { // the edge pixels extend out forever
+  static inline bool wrap(long long& c, size_t n) {
+    c = std::clamp(c, 0ll, (long long)n - 1);
+    return true;
+  }
+};
+
+struct wrap_mirror { // the buffer is reflected around its edge pixels, e.g., -1 -> 1, n -> n-2
+  static inline bool wrap(long long& c, size_t n) {
+    if (n == 1) {
+      c = 0;
+      return true;
+    }
+
+    long long period = 2 * ((long long)n - 1);
+    c %= period;
+    if (c < 0)
+      c += period;
+    if (c >= (long long)n)
+      c = period - c;
+    return true;
+  }
+};
+
+// no bounds work at all, only valid for coordinates that are known to be inside of the buffer,
+// e.g., in the interior blocks given by for_each_block
+struct wrap_interior {
+  static inline bool wrap(long long& c, size_t n) {
+    assert(0 <= c && c < (long long)n);
+    return true;
+  }
+};
+
+// filters for ibuffer::sample, pixel i is centered on coordinate i
+struct filter_nearest {
+  template <typename Wrap, typename Buffer>
+  static typename Buffer::pixel sample(Buffer const& buffer, float x, float y) {
+    return buffer.template fetch<Wrap>(std::floor(x + 0.5f), std::floor(y + 0.5f));
+  }
+};
+
+struct filter_bilinear {
+  template <typename Wrap, typename Buffer>
+  static typename Buffer::pixel sample(Buffer const& buffer, float x, float y) {
+    typedef typename Buffer::pixel pixel;
+
+    float cx = std::floor(x);
+    float cy = std::floor(y);
+
+    float tx = x - cx;
+    float ty = y - cy;
+
+    pixel Ptl = buffer.template fetch<Wrap>(cx, cy);
+    pixel Ptr = buffer.template fetch<Wrap>(cx + 1, cy);
+    pixel Pbl = buffer.template fetch<Wrap>(cx, cy + 1);
+    pixel Pbr = buffer.template fetch<Wrap>(cx + 1, cy + 1);
+
+    return pixel::lerp(ty, pixel::lerp(tx, Ptl, Ptr), pixel::lerp(tx, Pbl, Pbr));
+  }
+};
+
+// splits the rectangle [x0, x1) x [y0, y1) of a width x height buffer into blocks, calling
+// f(wrap, bx0, by0, bx1, by1) once for each. The block in the middle, where every pixel can be
+// sampled up to reach pixels away without leaving the buffer, gets wrap_interior{} so that its
+// samples skip bounds checks entirely, the (up to four) blocks around it get Wrap{}
+template <typename Wrap, typename F>
+void for_each_block(size_t width, size_t height, size_t x0, size_t y0, size_t x1, size_t y1,
+                    size_t reach, F&& f) {
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  size_t ix0 = std::max(x0, reach);
+  size_t iy0 = std::max(y0, reach);
+  size_t ix1 = std::min(x1, width > reach ? width - reach : 0);
+  size_t iy1 = std::min(y1, height > reach ? height - reach : 0);
+
+  if (ix0 >= ix1 || iy0 >= iy1) {
+    f(Wrap{}, x0, y0, x1, y1);
+    return;
+  }
+
+  if (y0 < iy0)
+    f(Wrap{}, x0, y0, x1, iy0);
+  if (x0 < ix0)
+    f(Wrap{}, x0, iy0, ix0, iy1);
+
+  f(wrap_interior{}, ix0, iy0, ix1, iy1);
+
+  if (ix1 < x1)
+    f(Wrap{}, ix1, iy0, x1, iy1);
+  if (iy1 < y1)
+    f(Wrap{}, x0, iy1, x1, y1);
+}
+
+// minimal allocator handing out memory aligned to Align bytes, for the planes of planar ibuffers
+template <typename T, size_t Align> struct aligned_allocator {
+  typedef T value_type;
+
+  template <typename TT> struct rebind {
+    typedef aligned_allocator<TT, Align> other;
+  };
+
+  aligned_allocator() = default;
+  template <typename TT> aligned_allocator(aligned_allocator<TT, Align> const&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+  }
+
+  void deallocate(T* ptr, size_t) { ::operator delete(ptr, std::align_val_t(Align)); }
+
+  template <typename TT> bool operator==(aligned_allocator<TT, Align> const&) const {
+    return true;
+  }
+  template <typename TT> bool operator!=(aligned_allocator<TT, Align> const&) const {
+    return false;
+  }
+};
+
+template <typename T, size_t depth, typename Layout> class ibuffer {
+  static_assert(std::is_same<Layout, interleaved>::value, "unknown ibuffer layout");
+
 public:
   typedef vec<T, depth> pixel;
   typedef long long int pos_t;
@@ -112,80 +256,46 @@ public:
 
   pixel& get(size_t idx) { return elements[idx]; }
 
-  pixel get_or_def(pos_t x, pos_t y) const {
-    if (x < 0 || x >= width || y < 0 || y >= height) {
+  // pixel at x, y, with out of bounds coordinates handled by Wrap, see wrap_def and co.
+  template <typename Wrap> pixel fetch(pos_t x, pos_t y) const {
+    if (!(Wrap::wrap(x, width) && Wrap::wrap(y, height)))
       return def;
-    }
     return elements[pos_to_idx(x, y)];
   }
 
-  pixel get_or_loop(pos_t x, pos_t y) const {
-    x = x % width;
-    y = y % height;
-    return elements[pos_to_idx(x, y)];
+  // filtered sample at fractional coordinates, see filter_nearest and filter_bilinear
+  template <typename Wrap, typename Filter = filter_nearest> pixel sample(float x, float y) const {
+    return Filter::template sample<Wrap>(*this, x, y);
   }
 
-  pixel get_or_clamp(pos_t x, pos_t y) const {
-    x = std::clamp(x, (pos_t)0, (pos_t)width - 1);
-    y = std::clamp(y, (pos_t)0, (pos_t)height - 1);
-    return elements[pos_to_idx(x, y)];
+  // splits a rectangle of this buffer into interior and border blocks, see ::for_each_block
+  template <typename Wrap, typename F>
+  void for_each_block(size_t x0, size_t y0, size_t x1, size_t y1, size_t reach, F&& f) const {
+    ::for_each_block<Wrap>(width, height, x0, y0, x1, y1, reach, std::forward<F>(f));
   }
 
-  // todo
-  pixel get_or_mirror(pos_t x, pos_t y) const {
-    x = std::abs(x);
-    y = std::abs(y);
+  pixel get_or_def(pos_t x, pos_t y) const { return fetch<wrap_def>(x, y); }
 
-    return elements[pos_to_idx(x, y)];
-  }
+  pixel get_or_loop(pos_t x, pos_t y) const { return fetch<wrap_loop>(x, y); }
 
-  // todo: come up with a unified way of handling different wrapping methods
-  pixel get_bilinear_loop(float x, float y) const {
-    float cx = std::floor(x);
-    float cy = std::floor(y);
+  pixel get_or_clamp(pos_t x, pos_t y) const { return fetch<wrap_clamp>(x, y); }
 
-    float tx = x - cx;
-    float ty = y - cy;
+  pixel get_or_mirror(pos_t x, pos_t y) const { return fetch<wrap_mirror>(x, y); }
 
-    pixel Ptl = get_or_loop(cx, cy);
-    pixel Ptr = get_or_loop(cx + 1, cy);
-    pixel Pbl = get_or_loop(cx, cy + 1);
-    pixel Pbr = get_or_loop(cx + 1, cy + 1);
-
-    return pixel::lerp(ty, pixel::lerp(tx, Ptl, Ptr),
-                       pixel::lerp(tx, Pbl, Pbr));
+  pixel get_bilinear_loop(float x, float y) const {
+    return sample<wrap_loop, filter_bilinear>(x, y);
   }
 
   pixel get_bilinear_clamp(float x, float y) const {
-    float cx = std::floor(x);
-    float cy = std::floor(y);
-
-    float tx = x - cx;
-    float ty = y - cy;
-
-    pixel Ptl = get_or_clamp(cx, cy);
-    pixel Ptr = get_or_clamp(cx + 1, cy);
-    pixel Pbl = get_or_clamp(cx, cy + 1);
-    pixel Pbr = get_or_clamp(cx + 1, cy + 1);
-
-    return pixel::lerp(ty, pixel::lerp(tx, Ptl, Ptr),
-                       pixel::lerp(tx, Pbl, Pbr));
+    return sample<wrap_clamp, filter_bilinear>(x, y);
   }
 
   pixel get_bilinear_def(float x, float y) const {
-    float cx = std::floor(x);
-    float cy = std::floor(y);
-
-    float tx = x - cx;
-    float ty = y - cy;
-
-    pixel Ptl = get_or_def(cx, cy);
-    pixel Ptr = get_or_def(cx + 1, cy);
-    pixel Pbl = get_or_def(cx, cy + 1);
-    pixel Pbr = get_or_def(cx + 1, cy + 1);
+    return sample<wrap_def, filter_bilinear>(x, y);
+  }
 
-    return pixel::lerp(ty, pixel::lerp(tx, Ptl, Ptr),
-                       pixel::lerp(tx, Pbl, Pbr));
+  pixel get_bilinear_mirror(float x, float y) const {
+    return sample<wrap_mirror, filter_bilinear>(x, y);
   }
 
   T get_el(pos_t x, pos_t y, pos_t z) const {
@@ -208,6 +318,8 @@ public:
 
   inline size_t get_extended_length() const { return length * depth; }
 
+  inline pixel const& get_def() const { return def; }
+
   std::vector<pixel>& data() { return elements; }
 
   void fill(T val) {
@@ -223,6 +335,44 @@ public:
   iterator begin() { return iterator(*this); }
   iterator end() { return iterator(*this, &elements.back() + 1); }
 
+  // calls f(pixel* begin, pixel* end, size_t y) for every row y of the rectangle
+  // [x0, x1) x [y0, y1), where [begin, end) are the contiguous pixels of that row. Cheaper than
+  // the iterator, which has to keep track of x/y/idx on every pixel, and leaves the compiler with
+  // a plain inner loop
+  template <typename F>
+  void for_each_row(size_t x0, size_t y0, size_t x1, size_t y1, F&& f) {
+    for (size_t y = y0; y < y1; y++) {
+      pixel* row = elements.data() + y * width;
+      f(row + x0, row + x1, y);
+    }
+  }
+
+  template <typename F>
+  void for_each_row(size_t x0, size_t y0, size_t x1, size_t y1, F&& f) const {
+    for (size_t y = y0; y < y1; y++) {
+      pixel const* row = elements.data() + y * width;
+      f(row + x0, row + x1, y);
+    }
+  }
+
+  template <typename F> void for_each_row(F&& f) {
+    for_each_row(0, 0, width, height, std::forward<F>(f));
+  }
+
+  template <typename F> void for_each_row(F&& f) const {
+    for_each_row(0, 0, width, height, std::forward<F>(f));
+  }
+
+  // calls f(y0, y1) for bands of rows [y0, y1) covering the buffer, in parallel over the pool. A
+  // few bands per thread keeps the threads busy when some rows are more expensive than others
+  template <typename F> void for_each_band(thread_pool& pool, F&& f) const {
+    size_t bands = std::min(height, 4 * (pool.size() + 1));
+    if (bands == 0)
+      return;
+
+    pool.parallel_for(0, bands, [&](size_t b) { f(b * height / bands, (b + 1) * height / bands); });
+  }
+
   void set_from(std::vector<T> const& arr) {
     if (arr.size() != get_extended_length()) {
       throw std::invalid_argument{"trying to set ibuffer with an array of size "
@@ -230,19 +380,13 @@ public:
                                   "length"};
     }
 
-    for (size_t y = 0; y < height; y++) {
-      size_t scanned = y * width;
-      for (size_t x = 0; x < width; x++) {
-        size_t idx = scanned + x;  // index into the pixel vector
-        size_t eidx = idx * depth; // extended index
-
-        pixel& p = get(idx);
-        unroll<depth>([&, this](auto i) {
-          // copy arr[eidx..eidx+depth+1] into pixel
-          p[i] = arr[eidx + i];
-        });
+    for_each_row([&](pixel* p, pixel* end, size_t y) {
+      T const* src = arr.data() + y * width * depth;
+      for (; p != end; p++, src += depth) {
+        // copy arr[eidx..eidx+depth+1] into pixel
+        unroll<depth>([&](auto i) { (*p)[i] = src[i]; });
       }
-    }
+    });
   }
 
   template <typename Iterator>
@@ -272,22 +416,16 @@ public:
   }
 
   // pretty much just swaps the assignment operands from set_from(vector<T>)
-  std::vector<T> to_arr() {
+  std::vector<T> to_arr() const {
     std::vector<T> arr(get_extended_length());
 
-    for (size_t y = 0; y < height; y++) {
-      size_t scanned = y * width;
-      for (size_t x = 0; x < width; x++) {
-        size_t idx = scanned + x;  // index into the pixel vector
-        size_t eidx = idx * depth; // extended index
-
-        pixel& p = get(idx);
-        unroll<depth>([&, this](auto i) {
-          // copy pixel into arr[eidx..eidx+depth+1]
-          arr[eidx + i] = p[i];
-        });
+    for_each_row([&](pixel const* p, pixel const* end, size_t y) {
+      T* dst = arr.data() + y * width * depth;
+      for (; p != end; p++, dst += depth) {
+        // copy pixel into arr[eidx..eidx+depth+1]
+        unroll<depth>([&](auto i) { dst[i] = (*p)[i]; });
       }
-    }
+    });
 
     return arr;
   }
@@ -320,11 +458,22 @@ public:
     }
   }
 
-  void apply(std::function<pixel(pixel const&)> const& filter) {
-    auto done = end();
-    for (auto it = begin(); it != done; it++) {
-      *it = filter(*it);
-    }
+  // replaces every pixel p with filter(p), filter can be any callable so that it gets inlined
+  template <typename F> void apply(F&& filter) {
+    for_each_row([&](pixel* p, pixel* end, size_t) {
+      for (; p != end; p++)
+        *p = filter(*p);
+    });
+  }
+
+  // apply split over bands of rows on the given pool, filter must be safe to call concurrently
+  template <typename F> void apply_par(F&& filter, thread_pool& pool = thread_pool::shared()) {
+    for_each_band(pool, [&](size_t y0, size_t y1) {
+      for_each_row(0, y0, width, y1, [&](pixel* p, pixel* end, size_t) {
+        for (; p != end; p++)
+          *p = filter(*p);
+      });
+    });
   }
 
   void scale(T s) {
@@ -351,10 +500,7 @@ public:
 
   // similar to apply, but generates a new buffer possibly of a different type
   // and depth
-  template <typename TT = T, size_t M = depth>
-  ibuffer<TT, M>
-  map(std::function<typename ibuffer<TT, M>::pixel(pixel const&)> const&
-          filter) {
+  template <typename TT = T, size_t M = depth, typename F> ibuffer<TT, M> map(F&& filter) const {
     ibuffer<TT, M> casted(width, height);
     auto& casted_elements = casted.data();
 
@@ -363,8 +509,222 @@ public:
     }
     return casted;
   }
+
+  // map split over bands of rows on the given pool, filter must be safe to call concurrently
+  template <typename TT = T, size_t M = depth, typename F>
+  ibuffer<TT, M> map_par(F&& filter, thread_pool& pool = thread_pool::shared()) const {
+    ibuffer<TT, M> casted(width, height);
+    auto& casted_elements = casted.data();
+
+    for_each_band(pool, [&](size_t y0, size_t y1) {
+      for (size_t i = y0 * width; i < y1 * width; i++) {
+        casted_elements[i] = filter(elements[i]);
+      }
+    });
+    return casted;
+  }
+
+  // copy of this buffer in the planar layout
+  ibuffer<T, depth, planar> to_planar() const;
 };
 
+// planar layout, every channel is stored in its own plane so that loops over a single channel run
+// over contiguous memory. Each plane starts on a 64 byte boundary, and rows are padded to a
+// multiple of 64 bytes so that every row does as well. Pixels are returned by value, since they
+// are not stored anywhere as a whole, so get does not return a reference like it does in the
+// interleaved layout, otherwise the API is the same.
+template <typename T, size_t depth> class ibuffer<T, depth, planar> {
+public:
+  typedef vec<T, depth> pixel;
+  typedef long long int pos_t;
+
+  static constexpr size_t alignment = 64;
+
+private:
+  // padding between rows is only there for alignment, so its bytes must divide the alignment
+  static_assert(alignment % sizeof(T) == 0, "planar ibuffer type doesn't divide the alignment");
+  static constexpr size_t align_elements = alignment / sizeof(T);
+
+  const size_t width;
+  const size_t height;
+  const float2 dim;
+
+  size_t length;
+  size_t stride;       // in elements, distance between the start of two rows of a plane
+  size_t plane_length; // in elements, distance between the start of two planes
+  std::vector<T, aligned_allocator<T, alignment>> elements;
+  pixel def;
+
+public:
+  ibuffer(size_t width, size_t height, pixel def = pixel())
+      : width(width), height(height), dim((float)width, (float)height), length(width * height),
+        stride((width + align_elements - 1) / align_elements * align_elements),
+        plane_length(stride * height), elements(plane_length * depth), def(def) {}
+
+  // converts from the interleaved layout
+  explicit ibuffer(ibuffer<T, depth, interleaved> const& other)
+      : ibuffer(other.get_width(), other.get_height(), other.get_def()) {
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x++)
+        set(x, y, other.cget(x, y));
+    }
+  }
+
+  void set(pos_t x, pos_t y, pixel val) {
+    size_t offset = pos_to_offset(x, y);
+    unroll<depth>([&, this](auto i) { elements[i * plane_length + offset] = val[i]; });
+  }
+
+  void set(pos_t idx, pixel val) { set(idx % width, idx / width, val); }
+
+  void set_el(pos_t x, pos_t y, pos_t z, T val) {
+    elements[z * plane_length + pos_to_offset(x, y)] = val;
+  }
+
+  pixel get(pos_t x, pos_t y) const { return cget(x, y); }
+
+  pixel cget(pos_t x, pos_t y) const {
+    size_t offset = pos_to_offset(x, y);
+    pixel p;
+    unroll<depth>([&, this](auto i) { p[i] = elements[i * plane_length + offset]; });
+    return p;
+  }
+
+  pixel get(size_t idx) const { return cget(idx % width, idx / width); }
+
+  template <typename Wrap> pixel fetch(pos_t x, pos_t y) const {
+    if (!(Wrap::wrap(x, width) && Wrap::wrap(y, height)))
+      return def;
+    return cget(x, y);
+  }
+
+  template <typename Wrap, typename Filter = filter_nearest> pixel sample(float x, float y) const {
+    return Filter::template sample<Wrap>(*this, x, y);
+  }
+
+  template <typename Wrap, typename F>
+  void for_each_block(size_t x0, size_t y0, size_t x1, size_t y1, size_t reach, F&& f) const {
+    ::for_each_block<Wrap>(width, height, x0, y0, x1, y1, reach, std::forward<F>(f));
+  }
+
+  pixel get_or_def(pos_t x, pos_t y) const { return fetch<wrap_def>(x, y); }
+
+  pixel get_or_loop(pos_t x, pos_t y) const { return fetch<wrap_loop>(x, y); }
+
+  pixel get_or_clamp(pos_t x, pos_t y) const { return fetch<wrap_clamp>(x, y); }
+
+  pixel get_or_mirror(pos_t x, pos_t y) const { return fetch<wrap_mirror>(x, y); }
+
+  pixel get_bilinear_loop(float x, float y) const {
+    return sample<wrap_loop, filter_bilinear>(x, y);
+  }
+
+  pixel get_bilinear_clamp(float x, float y) const {
+    return sample<wrap_clamp, filter_bilinear>(x, y);
+  }
+
+  pixel get_bilinear_def(float x, float y) const {
+    return sample<wrap_def, filter_bilinear>(x, y);
+  }
+
+  pixel get_bilinear_mirror(float x, float y) const {
+    return sample<wrap_mirror, filter_bilinear>(x, y);
+  }
+
+  T get_el(pos_t x, pos_t y, pos_t z) const {
+    return elements[z * plane_length + pos_to_offset(x, y)];
+  }
+
+  // offset of a pixel from the start of its plane
+  inline size_t pos_to_offset(pos_t x, pos_t y) const { return y * stride + x; }
+
+  float2 from_norm_coords(float2 coords) const { return coords * dim; }
+
+  float2 from_norm_cords(float x, float y) const { return float2(dim[0] * x, dim[1] * y); }
+
+  inline size_t get_width() const { return width; }
+
+  inline size_t get_height() const { return height; }
+
+  inline size_t get_length() const { return length; }
+
+  inline size_t get_extended_length() const { return length * depth; }
+
+  inline pixel const& get_def() const { return def; }
+
+  // in elements, the padding at the end of each row is included
+  inline size_t get_stride() const { return stride; }
+
+  // start of channel c, aligned to alignment bytes
+  T* plane(size_t c) { return elements.data() + c * plane_length; }
+  T const* plane(size_t c) const { return elements.data() + c * plane_length; }
+
+  // start of row y of channel c, also aligned to alignment bytes
+  T* row(size_t c, size_t y) { return plane(c) + y * stride; }
+  T const* row(size_t c, size_t y) const { return plane(c) + y * stride; }
+
+  void fill(T val) { std::fill(elements.begin(), elements.end(), val); }
+
+  void fill(pixel val) {
+    for (size_t c = 0; c < depth; c++)
+      std::fill(plane(c), plane(c) + plane_length, val[c]);
+  }
+
+  // arr is interleaved, e.g., r, g, b, a, r, g, b, a, ...
+  void set_from(std::vector<T> const& arr) {
+    if (arr.size() != get_extended_length()) {
+      throw std::invalid_argument{"trying to set ibuffer with an array of size "
+                                  "differing from the buffers extended "
+                                  "length"};
+    }
+
+    for (size_t c = 0; c < depth; c++) {
+      for (size_t y = 0; y < height; y++) {
+        T* dst = row(c, y);
+        T const* src = arr.data() + y * width * depth + c;
+        for (size_t x = 0; x < width; x++)
+          dst[x] = src[x * depth];
+      }
+    }
+  }
+
+  // interleaved copy of the values, the same as the interleaved layout's to_arr
+  std::vector<T> to_arr() const {
+    std::vector<T> arr(get_extended_length());
+
+    for (size_t c = 0; c < depth; c++) {
+      for (size_t y = 0; y < height; y++) {
+        T const* src = row(c, y);
+        T* dst = arr.data() + y * width * depth + c;
+        for (size_t x = 0; x < width; x++)
+          dst[x * depth] = src[x];
+      }
+    }
+
+    return arr;
+  }
+
+  // converts back to the interleaved layout
+  ibuffer<T, depth, interleaved> to_interleaved() const {
+    ibuffer<T, depth, interleaved> converted(width, height, def);
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x++)
+        converted.set(x, y, cget(x, y));
+    }
+    return converted;
+  }
+};
+
+template <typename T, size_t depth, typename Layout>
+ibuffer<T, depth, planar> ibuffer<T, depth, Layout>::to_planar() const {
+  ibuffer<T, depth, planar> converted(width, height, def);
+  for (size_t y = 0; y < height; y++) {
+    for (size_t x = 0; x < width; x++)
+      converted.set(x, y, cget(x, y));
+  }
+  return converted;
+}
+
 typedef ibuffer<char, 1> cbuffer1;
 typedef ibuffer<char, 2> cbuffer2;
 typedef ibuffer<char, 3> cbuffer3;
@@ -379,3 +739,8 @@ typedef ibuffer<float, 1> fbuffer1;
 typedef ibuffer<float, 2> fbuffer2;
 typedef ibuffer<float, 3> fbuffer3;
 typedef ibuffer<float, 4> fbuffer4;
+
+typedef ibuffer<float, 1, planar> pfbuffer1;
+typedef ibuffer<float, 2, planar> pfbuffer2;
+typedef ibuffer<float, 3, planar> pfbuffer3;
+typedef ibuffer<float, 4, planar> pfbuffer4;
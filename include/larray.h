@@ -3,10 +3,66 @@
 #include "common.h"
 #include "utils.h"
 
+#include <algorithm>
 #include <array>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 
 // Lua dedicated array
 
+// element types that larray is registered for, the Lua class name of each is given in the comment
+enum ARRAY_TYPE {
+  ARRAY_DOUBLE=0, // ldarray
+  ARRAY_FLOAT, // lfarray
+  ARRAY_U8, // lbarray
+  ARRAY_U16, // lwarray
+  ARRAY_U32, // luarray
+
+  ARRAY_TYPE_LAST
+};
+
+extern const char* ARRAY_TYPE_NAMES[5];
+
+// pixel layouts of Aseprite Image.bytes, all are 8 bits per channel
+enum BYTE_FORMAT {
+  BYTES_RGBA=0, // r, g, b, a
+  BYTES_GRAYSCALE, // value, alpha
+  BYTES_INDEXED, // palette index
+
+  BYTE_FORMAT_LAST
+};
+
+// nullptr terminated, as expected by luaL_checkoption
+extern const char* BYTE_FORMAT_NAMES[4];
+
+extern const size_t BYTE_FORMAT_CHANNELS[3];
+
+// converts a value to be stored in an larray<T>, integer types are rounded and saturated to their
+// range (e.g., colors stored in an lbarray are clamped to [0, 255]), also when narrowing from a
+// wider integer type
+template<typename T, typename TT>
+inline T larray_cast(TT val) {
+    if constexpr (std::is_integral<T>::value && std::is_floating_point<TT>::value) {
+        if (!(val > 0)) // also catches NaN
+            return 0;
+        if (val >= (TT)std::numeric_limits<T>::max())
+            return std::numeric_limits<T>::max();
+        return (T)std::llround(val);
+    } else if constexpr (std::is_integral<T>::value && std::is_integral<TT>::value) {
+        if constexpr (std::is_signed<TT>::value)
+            if (val < 0)
+                return 0;
+        if ((unsigned long long)val > (unsigned long long)std::numeric_limits<T>::max())
+            return std::numeric_limits<T>::max();
+        return (T)val;
+    } else {
+        return (T)val;
+    }
+}
+
 template<typename T>
 struct larray {
     size_t size;
@@ -17,6 +73,18 @@ struct larray {
     template<typename TT>
     void from(std::vector<TT> const& other);
 
+    // copies other into the values from offset on, other has to fit
+    template<typename TT>
+    void from(larray<TT> const& other, size_t offset = 0);
+
+    // allocates a new larray as userdata directly and leaves it on top of the stack, which avoids
+    // calling back into the Lua constructor (global lookup + protected call) for every array
+    static larray<T>* push(lua_State* L, size_t size);
+
+    // if the value at stack index idx is an larray<T> of the given size, pushes it again so that
+    // its memory can be reused, otherwise pushes a new one like push does
+    static larray<T>* push_or_reuse(lua_State* L, int idx, size_t size);
+
     // gets assigned directly to larray{}
     static int lnew(lua_State* L);
     static int gc(lua_State* L);
@@ -25,16 +93,101 @@ struct larray {
     static int get(lua_State* L);
     static int getsize(lua_State* L);
 
+    // __index, integer keys are forwarded to get and anything else is looked up in the methods
+    static int index(lua_State* L);
+
+    // bulk methods, each one runs over the whole array natively instead of going through
+    // get/set once per element. The ones that modify the array return it to allow chaining
+    static int fill(lua_State* L);       // arr:fill(v)
+    static int scale(lua_State* L);      // arr:scale(factor, offset = 0), v*factor + offset
+    static int clamp(lua_State* L);      // arr:clamp(lo, hi)
+    static int map_range(lua_State* L);  // arr:map_range(from_lo, from_hi, to_lo, to_hi)
+    static int min(lua_State* L);        // arr:min(), nil if empty
+    static int max(lua_State* L);        // arr:max(), nil if empty
+    static int sum(lua_State* L);        // arr:sum()
+    static int copy_from(lua_State* L);  // arr:copy_from(src, start = 1), src is a table or larray
+    static int slice(lua_State* L);      // arr:slice(i = 1, j = #arr), new larray of values i..j
+    static int unpack(lua_State* L);     // arr:unpack(i = 1, j = #arr), values i..j
+
+    // arr:to_bytes(format = "rgba", scale = 1), packs every value (times scale) into a byte, clamped
+    // and rounded, in the layout of an Aseprite Image.bytes string of the given format, see
+    // BYTE_FORMAT_NAMES
+    static int to_bytes(lua_State* L);
+
+    // the packing of to_bytes, writes size bytes to out
+    void pack_bytes(char out[], double scale = 1.0) const;
+
     static void register_class(lua_State* L);
+
+private:
+    // applies f to every value in place, converting the result back to T
+    template<typename F>
+    void transform(F&& f);
+
+    // checks that [i, j] (1-based, inclusive) is a valid range of the array, arguments at stack
+    // indices arg and arg+1 default to the whole array
+    static void check_range(lua_State* L, larray<T>* arr, int arg, size_t& i, size_t& j);
 };
 
+// empty stand-in for the element type T, see visit_array_type
+template<typename T>
+struct larray_tag { typedef T type; };
+
+// calls f(larray_tag<T>{}) with the element type T matching type, so that callers can pick the
+// array type at runtime but still work on the concrete larray<T>
+template<typename F>
+decltype(auto) visit_array_type(ARRAY_TYPE type, F&& f) {
+    switch (type) {
+    case ARRAY_FLOAT:
+        return f(larray_tag<float>{});
+    case ARRAY_U8:
+        return f(larray_tag<uint8_t>{});
+    case ARRAY_U16:
+        return f(larray_tag<uint16_t>{});
+    case ARRAY_U32:
+        return f(larray_tag<uint32_t>{});
+    case ARRAY_DOUBLE:
+    default:
+        return f(larray_tag<double>{});
+    }
+}
+
 template<typename T>
 template<typename TT>
 void larray<T>::from(std::vector<TT> const& other) {
     assert(other.size() == size);
     //memcpy(values, other.data(), other.size() * sizeof(TT));
     for(size_t i = 0; i < other.size(); i++)
-        values[i] = other[i];
+        values[i] = larray_cast<T>(other[i]);
+}
+
+template<typename T>
+template<typename TT>
+void larray<T>::from(larray<TT> const& other, size_t offset) {
+    assert(offset + other.size <= size);
+    if constexpr (std::is_same<T, TT>::value)
+        std::copy(other.values, other.values + other.size, values + offset);
+    else
+        for (size_t i = 0; i < other.size; i++)
+            values[offset + i] = larray_cast<T>(other.values[i]);
+}
+
+template<typename T>
+larray<T>* larray<T>::push(lua_State* L, size_t size) {
+    // note: (size-1) is used here, since larray is declared with values[1] (e.g., sizeof(larray)
+    // already takes one value into account), an empty array still holds on to that one value
+    size_t extra = (std::max<size_t>(size, 1) - 1) * sizeof(T);
+    return push_new_offset<larray<T>>(L, extra, size);
+}
+
+template<typename T>
+larray<T>* larray<T>::push_or_reuse(lua_State* L, int idx, size_t size) {
+    auto arr = (larray<T>*)luaL_testudata(L, idx, get_classname<larray<T>>());
+    if (arr == nullptr || arr->size != size)
+        return push(L, size);
+
+    lua_pushvalue(L, idx);
+    return arr;
 }
 
 template<typename T>
@@ -45,9 +198,7 @@ int larray<T>::lnew(lua_State* L) {
     // just grab the length and allocate the user data to fill to the end of the array
     size_t len = luaL_checknumber(L, idx);
 
-    // note: (len-1) is used here, since larray is declared with values[1] (e.g., sizeof(larray) 
-    // already takes one value into account)
-    push_new_offset<larray<T>>(L, (len-1)*sizeof(T), len);
+    push(L, len);
 
     return 1;
 }
@@ -58,6 +209,36 @@ int larray<T>::gc(lua_State* L) {
     return 0;
 }
 
+template<typename T>
+int larray<T>::set(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    int idx = (int)luaL_checkinteger(L, 2) - 1;
+
+    luaL_argcheck(L, arr != nullptr, 1, "'larray<T>' expected");
+    luaL_argcheck(L, 0 <= idx && (size_t)idx < arr->size, 2, "index out of range");
+    luaL_checkany(L, 3);
+
+    arr->values[idx] = larray_cast<T>(luaL_checknumber(L, 3));
+
+    return 0;
+}
+
+template<typename T>
+int larray<T>::get(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    int idx = (int)luaL_checkinteger(L, 2) - 1;
+
+    luaL_argcheck(L, arr != nullptr, 1, "'larray<T>' expected");
+    luaL_argcheck(L, 0 <= idx && (size_t)idx < arr->size, 2, "index out of range");
+
+    if constexpr (std::is_integral<T>::value)
+        lua_pushinteger(L, arr->values[idx]);
+    else
+        lua_pushnumber(L, arr->values[idx]);
+
+    return 1;
+}
+
 template<typename T>
 int larray<T>::getsize(lua_State* L) {
     larray<T>* arr = get_obj<larray<T>>(L, 1);
@@ -69,6 +250,285 @@ int larray<T>::getsize(lua_State* L) {
     return 1;
 }
 
+template<typename T>
+int larray<T>::index(lua_State* L) {
+    if (lua_type(L, 2) == LUA_TNUMBER)
+        return get(L);
+
+    // methods table is the only upvalue
+    lua_pushvalue(L, 2);
+    lua_gettable(L, lua_upvalueindex(1));
+    return 1;
+}
+
+template<typename T>
+template<typename F>
+void larray<T>::transform(F&& f) {
+    for (size_t i = 0; i < size; i++)
+        values[i] = larray_cast<T>(f((double)values[i]));
+}
+
+template<typename T>
+void larray<T>::check_range(lua_State* L, larray<T>* arr, int arg, size_t& i, size_t& j) {
+    lua_Integer from = luaL_optinteger(L, arg, 1);
+    lua_Integer to = luaL_optinteger(L, arg + 1, arr->size);
+
+    luaL_argcheck(L, 1 <= from && from <= (lua_Integer)arr->size + 1, arg, "index out of range");
+    luaL_argcheck(L, from - 1 <= to && to <= (lua_Integer)arr->size, arg + 1,
+                  "index out of range");
+
+    i = from;
+    j = to;
+}
+
+template<typename T>
+int larray<T>::fill(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    T val = larray_cast<T>(luaL_checknumber(L, 2));
+
+    std::fill(arr->values, arr->values + arr->size, val);
+
+    lua_settop(L, 1);
+    return 1;
+}
+
+template<typename T>
+int larray<T>::scale(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    double factor = luaL_checknumber(L, 2);
+    double offset = luaL_optnumber(L, 3, 0.0);
+
+    if constexpr (std::is_floating_point<T>::value) {
+        // kept in T so that the loop can be vectorized
+        T f = factor, o = offset;
+        for (size_t i = 0; i < arr->size; i++)
+            arr->values[i] = arr->values[i] * f + o;
+    } else {
+        arr->transform([=](double v) { return v * factor + offset; });
+    }
+
+    lua_settop(L, 1);
+    return 1;
+}
+
+template<typename T>
+int larray<T>::clamp(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    double lo = luaL_checknumber(L, 2);
+    double hi = luaL_checknumber(L, 3);
+
+    luaL_argcheck(L, lo <= hi, 3, "upper bound is less than the lower bound");
+
+    // the bounds are converted themselves, so the result is always in the range of T
+    T tlo = larray_cast<T>(lo), thi = larray_cast<T>(hi);
+    for (size_t i = 0; i < arr->size; i++)
+        arr->values[i] = std::min(std::max(arr->values[i], tlo), thi);
+
+    lua_settop(L, 1);
+    return 1;
+}
+
+template<typename T>
+int larray<T>::map_range(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    double from_lo = luaL_checknumber(L, 2);
+    double from_hi = luaL_checknumber(L, 3);
+    double to_lo = luaL_checknumber(L, 4);
+    double to_hi = luaL_checknumber(L, 5);
+
+    luaL_argcheck(L, from_lo != from_hi, 3, "source range is empty");
+
+    double factor = (to_hi - to_lo) / (from_hi - from_lo);
+    double offset = to_lo - from_lo * factor;
+
+    // same as scale, map_range is just a more convenient way of giving the factor/offset
+    if constexpr (std::is_floating_point<T>::value) {
+        T f = factor, o = offset;
+        for (size_t i = 0; i < arr->size; i++)
+            arr->values[i] = arr->values[i] * f + o;
+    } else {
+        arr->transform([=](double v) { return v * factor + offset; });
+    }
+
+    lua_settop(L, 1);
+    return 1;
+}
+
+template<typename T>
+int larray<T>::min(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+
+    if (arr->size == 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    T m = arr->values[0];
+    for (size_t i = 1; i < arr->size; i++)
+        m = std::min(m, arr->values[i]);
+
+    if constexpr (std::is_integral<T>::value)
+        lua_pushinteger(L, m);
+    else
+        lua_pushnumber(L, m);
+
+    return 1;
+}
+
+template<typename T>
+int larray<T>::max(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+
+    if (arr->size == 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    T m = arr->values[0];
+    for (size_t i = 1; i < arr->size; i++)
+        m = std::max(m, arr->values[i]);
+
+    if constexpr (std::is_integral<T>::value)
+        lua_pushinteger(L, m);
+    else
+        lua_pushnumber(L, m);
+
+    return 1;
+}
+
+template<typename T>
+int larray<T>::sum(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+
+    if constexpr (std::is_integral<T>::value) {
+        // can't overflow for any array that fits in memory
+        lua_Integer total = 0;
+        for (size_t i = 0; i < arr->size; i++)
+            total += arr->values[i];
+        lua_pushinteger(L, total);
+    } else {
+        double total = 0.0;
+        for (size_t i = 0; i < arr->size; i++)
+            total += arr->values[i];
+        lua_pushnumber(L, total);
+    }
+
+    return 1;
+}
+
+template<typename T>
+int larray<T>::copy_from(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    lua_Integer start = luaL_optinteger(L, 3, 1);
+
+    luaL_argcheck(L, 1 <= start && start <= (lua_Integer)arr->size + 1, 3, "index out of range");
+    size_t offset = start - 1;
+
+    if (lua_istable(L, 2)) {
+        size_t len = luaL_len(L, 2);
+        luaL_argcheck(L, offset + len <= arr->size, 2, "source doesn't fit in the array");
+
+        for (size_t i = 0; i < len; i++) {
+            lua_geti(L, 2, i + 1);
+            arr->values[offset + i] = larray_cast<T>(lua_tonumber(L, -1));
+            lua_pop(L, 1);
+        }
+
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    // any larray type can be copied from, values are converted the same way as in set
+    bool copied = false;
+    for (int type = ARRAY_DOUBLE; type < ARRAY_TYPE_LAST && !copied; type++) {
+        visit_array_type((ARRAY_TYPE)type, [&](auto tag) {
+            typedef typename decltype(tag)::type TT;
+
+            auto src = (larray<TT>*)luaL_testudata(L, 2, get_classname<larray<TT>>());
+            if (src == nullptr)
+                return;
+
+            luaL_argcheck(L, offset + src->size <= arr->size, 2, "source doesn't fit in the array");
+
+            arr->from(*src, offset);
+
+            copied = true;
+        });
+    }
+
+    luaL_argexpected(L, copied, 2, "table or larray");
+
+    lua_settop(L, 1);
+    return 1;
+}
+
+template<typename T>
+int larray<T>::slice(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+
+    size_t i, j;
+    check_range(L, arr, 2, i, j);
+
+    size_t len = j + 1 - i;
+
+    larray<T>* sliced = push(L, len);
+    std::copy(arr->values + i - 1, arr->values + j, sliced->values);
+
+    return 1;
+}
+
+template<typename T>
+int larray<T>::unpack(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+
+    size_t i, j;
+    check_range(L, arr, 2, i, j);
+
+    int n = j + 1 - i;
+    if (n > 0 && (n >= INT_MAX || !lua_checkstack(L, n)))
+        return luaL_error(L, "too many results to unpack");
+
+    for (size_t k = i - 1; k < j; k++) {
+        if constexpr (std::is_integral<T>::value)
+            lua_pushinteger(L, arr->values[k]);
+        else
+            lua_pushnumber(L, arr->values[k]);
+    }
+
+    return n;
+}
+
+template<typename T>
+int larray<T>::to_bytes(lua_State* L) {
+    larray<T>* arr = get_obj<larray<T>>(L, 1);
+    BYTE_FORMAT format = (BYTE_FORMAT)luaL_checkoption(L, 2, "rgba", BYTE_FORMAT_NAMES);
+    double scale = luaL_optnumber(L, 3, 1.0);
+
+    size_t channels = BYTE_FORMAT_CHANNELS[format];
+    if (arr->size % channels != 0)
+        return luaL_error(L, "array length %d is not a multiple of the %d channels of '%s'",
+                          (int)arr->size, (int)channels, BYTE_FORMAT_NAMES[format]);
+
+    luaL_Buffer b;
+    char* bytes = luaL_buffinitsize(L, &b, arr->size);
+
+    arr->pack_bytes(bytes, scale);
+    luaL_pushresultsize(&b, arr->size);
+
+    return 1;
+}
+
+template<typename T>
+void larray<T>::pack_bytes(char out[], double scale) const {
+    // integer values saturate through larray_cast as well, so 300 in an lwarray packs to 255
+    if (scale == 1.0)
+        for (size_t i = 0; i < size; i++)
+            out[i] = (char)larray_cast<uint8_t>(values[i]);
+    else
+        for (size_t i = 0; i < size; i++)
+            out[i] = (char)larray_cast<uint8_t>(values[i] * scale);
+}
+
 template<typename T>
 void larray<T>::register_class(lua_State* L) {
     static const luaL_Reg larray_methods[] = {
@@ -76,12 +536,42 @@ void larray<T>::register_class(lua_State* L) {
         // { "set", larray<T>::set },
         { "__newindex", larray<T>::set },
         // { "get", larray<T>::get },
-        { "__index", larray<T>::get },
         // { "size", larray<T>::getsize },
         { "__len", larray<T>::getsize },
         { nullptr, nullptr }
     };
 
+    static const luaL_Reg larray_bulk_methods[] = {
+        { "fill", larray<T>::fill },
+        { "scale", larray<T>::scale },
+        { "clamp", larray<T>::clamp },
+        { "map_range", larray<T>::map_range },
+        { "min", larray<T>::min },
+        { "max", larray<T>::max },
+        { "sum", larray<T>::sum },
+        { "copy_from", larray<T>::copy_from },
+        { "slice", larray<T>::slice },
+        { "unpack", larray<T>::unpack },
+        { "to_bytes", larray<T>::to_bytes },
+        { nullptr, nullptr }
+    };
+
     REG_LUA_CLASS(L, larray<T>, larray_methods);
     REG_LUA_CNSTR(L, larray<T>, larray<T>::lnew);
-}
\ No newline at end of file
+
+    // __index gets the methods table as an upvalue, so that arr[i] and arr:method() both work
+    luaL_getmetatable(L, get_classname<larray<T>>());
+    lua_newtable(L);
+    luaL_setfuncs(L, larray_bulk_methods, 0);
+    lua_pushcclosure(L, larray<T>::index, 1);
+    lua_setfield(L, -2, "__index");
+    lua_pop(L, 1);
+}
+
+// larray.from_bytes(str, array_type = U8, scale = 1), the reverse of arr:to_bytes, creates a new
+// larray of the given libnoise.ARRAY_TYPES type with one value (byte times scale) per byte of str
+int larray_from_bytes(lua_State* L);
+
+// registers every larray type, e.g., ldarray, lfarray, lbarray, ..., along with the global larray
+// table of functions shared between them
+void register_larray_classes(lua_State* L);
@@ -0,0 +1,355 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// integer cell of a Dim dimensional lattice, see lattice3::cell_of
+template <size_t Dim> using lattice_cell = std::array<long long, Dim>;
+
+// what went through a lattice so far, the peaks are high-water marks of what was stored at once
+struct lattice_stats {
+  size_t generated = 0; // slabs generated
+  size_t evicted = 0;   // slabs dropped by retain/advance, or replaced by a far away prefetch
+  size_t recycled = 0;  // generated slabs that reused the storage of an evicted one
+  size_t peak_slabs = 0;
+  size_t peak_cells = 0;
+};
+
+// lattice of cells that each own a T, e.g., the points of a Worley cell or the gradient of a Perlin
+// corner. Values are made by Generator, called as T gen(lattice_cell<Dim> const&), which has to be
+// a pure function of the cell since cells are generated in parallel, and may be evicted and
+// generated again later.
+//
+// Cells are stored densely in slabs along the last axis (z for 3D, y for 2D), every other axis is
+// bounded by [lo, hi] given on construction. Only a contiguous range of slabs is kept at a time, so
+// callers that move along the last axis (e.g., animations moving through z) prefetch the slabs they
+// are about to read and drop the ones they are done with.
+template <size_t Dim, typename T, typename Generator> class lattice {
+  static_assert(Dim >= 1, "lattice needs at least one axis");
+
+public:
+  typedef lattice_cell<Dim> cell_t;
+  static constexpr size_t slab_axis = Dim - 1;
+
+  // every cell of a single step along the slab axis
+  class slab {
+    friend class lattice;
+
+    long long pos;
+    std::vector<T> values;
+
+  public:
+    inline long long get_pos() const { return pos; }
+    inline T const& get(size_t idx) const { return values[idx]; }
+  };
+
+  typedef lattice_stats stats_t;
+
+  // how many evicted slabs are kept around for their storage to be reused
+  static constexpr size_t MAX_SPARE_SLABS = 2;
+
+private:
+  Generator gen;
+
+  cell_t lo;
+  cell_t hi; // inclusive
+  std::array<size_t, Dim> extent;
+  std::array<size_t, Dim> stride;
+  size_t slab_size = 1;
+
+  long long first = 0; // position of slabs.front()
+  std::deque<slab> slabs;
+
+  std::vector<slab> spare;
+  stats_t stats;
+
+  void evict(slab&& s) {
+    stats.evicted++;
+    if (spare.size() < MAX_SPARE_SLABS)
+      spare.push_back(std::move(s));
+  }
+
+  // generated slab at pos, reusing a spare slab if there is one
+  slab make_slab(long long pos) {
+    slab s;
+    if (!spare.empty()) {
+      s = std::move(spare.back());
+      spare.pop_back();
+      stats.recycled++;
+    }
+
+    generate(s, pos);
+    stats.generated++;
+    return s;
+  }
+
+  void update_peaks() {
+    stats.peak_slabs = std::max(stats.peak_slabs, slabs.size());
+    stats.peak_cells = std::max(stats.peak_cells, size());
+  }
+
+  // index of cell within its slab, ignoring the slab axis
+  inline size_t offset_of(cell_t const& cell) const {
+    size_t offset = 0;
+    for (size_t a = slab_axis; a-- > 0;)
+      offset = offset * extent[a] + (size_t)(cell[a] - lo[a]);
+    return offset;
+  }
+
+  void generate(slab& s, long long pos) const {
+    s.pos = pos;
+    s.values.resize(slab_size);
+
+    // the slab is split in rows along the first axis, which are generated in parallel
+    size_t row = extent[0];
+    size_t rows = slab_size / row;
+    thread_pool::shared().parallel_for(0, rows, [&](size_t r) {
+      cell_t cell;
+      cell[slab_axis] = pos;
+
+      size_t rest = r;
+      for (size_t a = 1; a < slab_axis; a++) {
+        cell[a] = lo[a] + (long long)(rest % extent[a]);
+        rest /= extent[a];
+      }
+
+      for (size_t i = 0; i < row; i++) {
+        if constexpr (Dim > 1)
+          cell[0] = lo[0] + (long long)i;
+        s.values[r * row + i] = gen(cell);
+      }
+    });
+  }
+
+public:
+  // lo and hi bound every axis but the slab axis, inclusively, whatever is given for the slab axis
+  // is ignored
+  lattice(cell_t lo, cell_t hi, Generator gen = Generator())
+      : gen(std::move(gen)), lo(lo), hi(hi) {
+    extent[slab_axis] = 1;
+    for (size_t a = 0; a < slab_axis; a++) {
+      if (hi[a] < lo[a])
+        throw std::invalid_argument{"lattice bounds are empty along axis " + std::to_string(a)};
+      extent[a] = (size_t)(hi[a] - lo[a] + 1);
+      stride[a] = slab_size;
+      slab_size *= extent[a];
+    }
+    stride[slab_axis] = 0;
+  }
+
+  inline Generator const& get_generator() const { return gen; }
+  inline cell_t const& get_lo() const { return lo; }
+  inline cell_t const& get_hi() const { return hi; }
+
+  inline size_t size() const { return slabs.size() * slab_size; }
+  inline size_t slab_count() const { return slabs.size(); }
+  inline bool empty() const { return slabs.empty(); }
+
+  // range of slabs currently stored, [first_slab(), last_slab()], only valid if !empty()
+  inline long long first_slab() const { return first; }
+  inline long long last_slab() const { return first + (long long)slabs.size() - 1; }
+
+  inline bool has_slab(long long pos) const {
+    return !slabs.empty() && pos >= first && pos <= last_slab();
+  }
+
+  inline bool in_bounds(cell_t const& cell) const {
+    for (size_t a = 0; a < slab_axis; a++)
+      if (cell[a] < lo[a] || cell[a] > hi[a])
+        return false;
+    return true;
+  }
+
+  // generates every cell of the slabs [from, to] that isn't stored yet. Stored slabs stay
+  // contiguous, so a range that neither overlaps nor touches the stored one replaces it.
+  void prefetch(long long from, long long to) {
+    if (to < from)
+      return;
+
+    if (slabs.empty() || to < first - 1 || from > last_slab() + 1) {
+      clear();
+      first = from;
+      for (long long pos = from; pos <= to; pos++)
+        slabs.push_back(make_slab(pos));
+      update_peaks();
+      return;
+    }
+
+    for (long long pos = first - 1; pos >= from; pos--) {
+      slabs.push_front(make_slab(pos));
+      first = pos;
+    }
+    for (long long pos = last_slab() + 1; pos <= to; pos++)
+      slabs.push_back(make_slab(pos));
+    update_peaks();
+  }
+
+  // drops every slab outside of [from, to]
+  void retain(long long from, long long to) {
+    if (slabs.empty())
+      return;
+
+    if (to < from || to < first || from > last_slab()) {
+      clear();
+      return;
+    }
+
+    while (first < from) {
+      evict(std::move(slabs.front()));
+      slabs.pop_front();
+      first++;
+    }
+    while (last_slab() > to) {
+      evict(std::move(slabs.back()));
+      slabs.pop_back();
+    }
+  }
+
+  // moves the stored range to exactly [from, to], evicting whatever falls behind before generating
+  // what is new, so that moving along the slab axis keeps a bounded number of slabs around
+  void advance(long long from, long long to) {
+    retain(from, to);
+    prefetch(from, to);
+  }
+
+  void clear() {
+    while (!slabs.empty()) {
+      evict(std::move(slabs.back()));
+      slabs.pop_back();
+    }
+  }
+
+  inline stats_t const& get_stats() const { return stats; }
+
+  // stored slab at pos, which must have been prefetched
+  slab const& get_slab(long long pos) const {
+    if (!has_slab(pos))
+      throw std::out_of_range{"lattice slab " + std::to_string(pos) + " was not prefetched"};
+    return slabs[(size_t)(pos - first)];
+  }
+
+  // values of the slab at pos, laid out so that the cell at c is at the sum of axis_offset(a, c[a])
+  // over every axis a but the slab axis
+  inline T const* slab_data(long long pos) const { return get_slab(pos).values.data(); }
+
+  inline size_t axis_offset(size_t axis, long long c) const {
+    if (c < lo[axis] || c > hi[axis])
+      throw std::out_of_range{"lattice cell is out of the lattice's bounds"};
+    return (size_t)(c - lo[axis]) * stride[axis];
+  }
+
+  // index of a cell within any slab, see slab::get
+  inline size_t index_of(cell_t const& cell) const {
+    if (!in_bounds(cell))
+      throw std::out_of_range{"lattice cell is out of the lattice's bounds"};
+    return offset_of(cell);
+  }
+
+  // value of a cell, generating its slab first if needed
+  T const& at(cell_t const& cell) {
+    prefetch(cell[slab_axis], cell[slab_axis]);
+    return get(cell);
+  }
+
+  // value of a cell whose slab has already been prefetched
+  T const& get(cell_t const& cell) const {
+    return get_slab(cell[slab_axis]).get(index_of(cell));
+  }
+};
+
+// lattice that repeats along every axis, with a period of period[a] cells along axis a. It only has
+// a finite number of distinct cells, so they are all generated once on construction and lookups
+// never have to generate anything. Cells are wrapped into [0, period) first, the generator only
+// ever sees those wrapped cells.
+//
+// Has the same lookup API as lattice, so code can be written against either of them.
+template <size_t Dim, typename T, typename Generator> class periodic_lattice {
+  static_assert(Dim >= 1, "lattice needs at least one axis");
+
+public:
+  typedef lattice_cell<Dim> cell_t;
+  static constexpr size_t slab_axis = Dim - 1;
+
+private:
+  Generator gen;
+
+  cell_t period;
+  std::array<size_t, Dim> stride;
+  std::vector<T> values;
+
+  static inline long long wrap(long long c, long long p) {
+    c %= p;
+    return c < 0 ? c + p : c;
+  }
+
+public:
+  periodic_lattice(cell_t period, Generator gen = Generator())
+      : gen(std::move(gen)), period(period) {
+    size_t length = 1;
+    for (size_t a = 0; a < Dim; a++) {
+      if (period[a] <= 0)
+        throw std::invalid_argument{"periodic lattice needs a period along axis " +
+                                    std::to_string(a)};
+      stride[a] = length;
+      length *= (size_t)period[a];
+    }
+
+    // generated in parallel, one row along the first axis at a time
+    size_t row = (size_t)period[0];
+    values.resize(length);
+    thread_pool::shared().parallel_for(0, length / row, [&](size_t r) {
+      cell_t cell;
+      size_t rest = r;
+      for (size_t a = 1; a < Dim; a++) {
+        cell[a] = (long long)(rest % (size_t)period[a]);
+        rest /= (size_t)period[a];
+      }
+
+      for (size_t i = 0; i < row; i++) {
+        cell[0] = (long long)i;
+        values[r * row + i] = this->gen(cell);
+      }
+    });
+  }
+
+  inline Generator const& get_generator() const { return gen; }
+  inline cell_t const& get_period() const { return period; }
+  inline size_t size() const { return values.size(); }
+
+  // everything is generated once and kept, so the stats never change after construction
+  lattice_stats get_stats() const {
+    lattice_stats stats;
+    stats.generated = stats.peak_slabs = (size_t)period[slab_axis];
+    stats.peak_cells = values.size();
+    return stats;
+  }
+
+  // every cell always exists, so there is nothing to prefetch or evict
+  inline void prefetch(long long, long long) {}
+  inline void retain(long long, long long) {}
+  inline void advance(long long, long long) {}
+
+  inline T const* slab_data(long long pos) const {
+    return values.data() + wrap(pos, period[slab_axis]) * stride[slab_axis];
+  }
+
+  inline size_t axis_offset(size_t axis, long long c) const {
+    return (size_t)wrap(c, period[axis]) * stride[axis];
+  }
+
+  T const& get(cell_t const& cell) const {
+    size_t idx = 0;
+    for (size_t a = 0; a < Dim; a++)
+      idx += axis_offset(a, cell[a]);
+    return values[idx];
+  }
+
+  inline T const& at(cell_t const& cell) const { return get(cell); }
+};
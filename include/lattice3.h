@@ -2,11 +2,10 @@
 
 #include "vector3.h"
 
+#include <cstdint>
 #include <random>
 
-// TODO: consider making latices generic, and able to pass in a type for their cache. e.g.,
-// std::unordered_map<dvec3, T> cache.
-// having the caches in the lattice itself feels more appropriate.
+// maps positions to cells and seeds, see lattice.h for storing a value per cell
 
 class lattice3 {
     dvec3 offset;
@@ -16,6 +15,7 @@ class lattice3 {
 
     unsigned int seed;
     dvec3 scaled_freq;
+    ivec3 period; // freq rounded to whole cells, 0 if not repeating
 
 public:
     lattice3(double cs, dvec3 freq);
@@ -27,4 +27,32 @@ public:
     dvec3 get_corner(const dvec3& v) const;
     dvec3 point_rep(double x, double y, double z) const;
     dvec3 point_rep(const dvec3& v) const;
-};
\ No newline at end of file
+
+    // integer cell API, cells are identified by their index along each axis, i.e., the cell at
+    // index i spans [i*cs, (i+1)*cs)
+    inline double get_cellsize() const { return cs; }
+
+    // how many cells the lattice repeats after along each axis, 0 for axes that don't repeat
+    inline ivec3 const& get_period() const { return period; }
+
+    long long cell_of(double v) const;
+    ivec3 cell_of(double x, double y, double z) const;
+
+    // position of the top left (front) corner of a cell
+    dvec3 corner_of(const ivec3& cell) const;
+
+    // wraps a cell into the repeating part of the lattice, based on freq
+    ivec3 cell_rep(const ivec3& cell) const;
+
+    // seed of a cell, equal for every cell that wraps to the same cell_rep
+    uint64_t cell_seed(const ivec3& cell) const;
+
+    // cell index of pixels from, from + 1, ..., from + count - 1 along a single axis, so that a
+    // scanline only looks up a table instead of dividing for every pixel
+    void cells_along(double from, size_t count, long long out[]) const;
+
+    // cheap hash for integer cells, meant for unordered containers keyed on them
+    struct cell_hash {
+        size_t operator()(const ivec3& cell) const;
+    };
+};
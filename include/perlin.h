@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common.h"
+#include "fractal.h"
+
+#include <string>
+
+// Perlin (gradient) noise, summed over octaves where every octave halves the cellsize and weight of
+// the previous one. Same options as perlin() in perlin.lua, but computed natively and in parallel
+// across every row of every frame. This is fBm of gradient octaves with lacunarity 2 and gain 0.5,
+// computed by fractal_engine, of whose options it only reads:
+//
+//   seed: int, width: double, height: double, length: int (in frames), cellsize: double,
+//   octaves: int (1 by default), dimensions: int, movement: double, loops: table {x, y, z},
+//   array_type: enum
+class Perlin {
+  fractal_engine engine;
+
+public:
+  std::string to_string() const;
+
+  static int lnew(lua_State* L);
+  // P:set{...}, changes any of the properties given to the constructor and returns P
+  static int set(lua_State* L);
+  // P:compute(), table of length larrays of width * height noise values in about [-1, 1]
+  static int compute(lua_State* L);
+  // P:compute_into(frames), same as compute but fills (and returns) the given table of frames,
+  // which allows the larrays of a previous call to be recycled
+  static int compute_into(lua_State* L);
+  static int to_string(lua_State* L);
+  static void register_class(lua_State* L);
+};
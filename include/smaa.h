@@ -2,16 +2,78 @@
 
 #include "common.h"
 #include "ibuffer.h"
+#include "larray.h"
+
+#include <vector>
+
+enum EDGE_DETECTION {
+  COLOR_EDGES=0,
+  LUMA_EDGES,
+
+  EDGE_DETECTION_LAST
+};
+
+extern const char* EDGE_DETECTION_NAMES[2];
+
+enum LOOKUP_PRECISION {
+  LOOKUP_U8=0, // packed 8-bit area/search textures, sampled directly
+  LOOKUP_FLOAT, // float copies of the textures, kept as a reference for validation
+
+  LOOKUP_PRECISION_LAST
+};
+
+extern const char* LOOKUP_PRECISION_NAMES[2];
 
 class SMAA {    
+    EDGE_DETECTION edge_detection = COLOR_EDGES;
+    LOOKUP_PRECISION lookup_precision = LOOKUP_U8;
+    bool incremental = false; // apply_animation only recomputes what changed between frames
+    size_t tile_size = 128; // images larger than this are filtered in tiles, 0 disables tiling
+    ARRAY_TYPE array_type = ARRAY_DOUBLE; // element type of the larrays returned to Lua
+
 public:
     enum STEPS {
         EDGES=1, WEIGHTS, BLENDING
     };
 
-    SMAA();
+    // half-open rectangle of pixels [x0, x1) x [y0, y1) that a pass is restricted to
+    struct region {
+        size_t x0, y0, x1, y1;
+    };
+
+    SMAA(EDGE_DETECTION edge_detection = COLOR_EDGES,
+         LOOKUP_PRECISION lookup_precision = LOOKUP_U8);
+
+    // reads SMAA options from the table at stack index idx
+    void load_options(lua_State* L, int idx);
+
+    inline bool is_incremental() const { return incremental; }
+
+    inline ARRAY_TYPE get_array_type() const { return array_type; }
+
+    inline size_t get_tile_size() const { return tile_size; }
+    inline void set_tile_size(size_t size) { tile_size = size; }
 
     ibuffer4 apply(fbuffer4 orig_buffer);
+
+    // filters the image one tile_size x tile_size tile at a time, running every pass over a tile
+    // (plus the halo of pixels that its output depends on) before moving on to the next one. Only
+    // the tiles currently being worked on are kept in memory, instead of full size intermediates.
+    // The results are identical to the untiled passes.
+    ibuffer4 apply_tiled(fbuffer4 const& colors) const;
+
+    // filters the frames of an animation in order. Each frame is diffed against the previous one,
+    // and only the edges/weights/colors that the changed pixels can reach are recomputed, the rest
+    // is reused from the previous frame. The results are identical to calling apply per frame.
+    std::vector<ibuffer4> apply_animation(std::vector<fbuffer4> const& frames) const;
+
+private:
+    void detect_edges(fbuffer4 const& colors, fbuffer1 const& luma, fbuffer2& edges,
+                      region r) const;
+    void calculate_weights(fbuffer2 const& edges, fbuffer4& blending, region r) const;
+    void blend_neighborhood(fbuffer4 const& colors, fbuffer4 const& blending,
+                            fbuffer4& aabuffer, region r) const;
 };
 
-int l_SMAA(lua_State* L);
\ No newline at end of file
+int l_SMAA(lua_State* L);
+int l_SMAA_batch(lua_State* L);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// simple fixed-size pool of worker threads, meant for splitting frames/rows of the native noise and
+// filter methods over the available cores. Lua is never touched from inside of a worker, so
+// anything read from or pushed onto the Lua stack must happen before/after the parallel section.
+class thread_pool {
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+
+  void work();
+
+public:
+  // nthreads == 0 uses the number of hardware threads
+  explicit thread_pool(size_t nthreads = 0);
+  ~thread_pool();
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  inline size_t size() const { return workers.size(); }
+
+  void submit(std::function<void()> task);
+
+  // calls f(i) for every i in [begin, end), blocking until all calls are done. The calling thread
+  // also takes indices, so this is safe to call from inside of another task. The first exception
+  // thrown by f is rethrown here.
+  template <typename F> void parallel_for(size_t begin, size_t end, F&& f);
+
+  // lazily created pool shared by the whole library
+  static thread_pool& shared();
+};
+
+template <typename F> void thread_pool::parallel_for(size_t begin, size_t end, F&& f) {
+  if (begin >= end)
+    return;
+
+  struct state_t {
+    std::atomic<size_t> next;
+    size_t finished = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  size_t count = end - begin;
+  auto state = std::make_shared<state_t>();
+  state->next = begin;
+
+  // helpers may start after every index has already been taken, in which case they just leave, so
+  // the caller only ever waits on indices that are actually in flight
+  auto run = [state, end, count, &f]() {
+    size_t i;
+    while ((i = state->next++) < end) {
+      std::exception_ptr error;
+      try {
+        f(i);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (error && !state->error)
+        state->error = error;
+      if (++state->finished == count)
+        state->cv.notify_all();
+    }
+  };
+
+  size_t helpers = std::min(count, workers.size() + 1) - 1;
+  for (size_t h = 0; h < helpers; h++)
+    submit(run);
+
+  run();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&]() { return state->finished == count; });
+
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
@@ -105,10 +105,9 @@ T* push_new_offset(lua_State* L, size_t offset, Args&&... args) {
 template <typename T>
 void try_get_num_field(lua_State* L, T& store, int idx, int stack,
                        const char* key) {
-  if (lua_getfield(L, idx, key) != LUA_TNIL) {
+  if (lua_getfield(L, idx, key) != LUA_TNIL)
     store = luaL_checknumber(L, stack);
-    lua_pop(L, 1);
-  }
+  lua_pop(L, 1);
 }
 
 template<typename T>
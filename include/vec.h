@@ -10,6 +10,17 @@
 
 #include <iostream>
 
+// float4/float2 arithmetic is done in SSE registers when the target has SSE2 (always the case on
+// x86-64), everything else, and every other target (e.g. arm64), uses the plain unrolled loops.
+// Defining VEC_NO_SIMD forces the plain loops everywhere.
+#if !defined(VEC_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VEC_SSE 1
+#include <emmintrin.h>
+#else
+#define VEC_SSE 0
+#endif
+
 template<size_t... inds, class F>
 constexpr void unroll(std::integer_sequence<size_t, inds...>, F&& f) {
     (f(std::integral_constant<size_t, inds>{}), ...);
@@ -20,12 +31,76 @@ constexpr void unroll(F&& f) {
     unroll(std::make_integer_sequence<size_t, len>{}, std::forward<F>(f));
 }
 
+// SSE backend of a vec<T, N>, only enabled for the types/sizes that fit in a register. Every op is
+// lane-wise, so results are bit for bit the same as the unrolled loops
+template<typename T, size_t N>
+struct vec_sse {
+    static constexpr bool enabled = false;
+    static constexpr size_t alignment = alignof(std::array<T, N>);
+};
+
+#if VEC_SSE
+struct vec_sse_ops {
+    typedef __m128 reg;
+
+    static inline reg set1(float v) { return _mm_set1_ps(v); }
+
+    static inline reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static inline reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static inline reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+    static inline reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+
+    // a > b ? a : b / a < b ? a : b, note that the argument order matters for NaNs and signed zeros
+    static inline reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+    static inline reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+
+    static inline reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+    // a >= b ? 1 : 0
+    static inline reg step(reg a, reg b) {
+        return _mm_and_ps(_mm_cmpge_ps(a, b), _mm_set1_ps(1.0f));
+    }
+};
+
+template<>
+struct vec_sse<float, 4> : vec_sse_ops {
+    static constexpr bool enabled = true;
+    static constexpr size_t alignment = 16;
+
+    static inline reg load(float const* p) { return _mm_load_ps(p); }
+    static inline void store(float* p, reg v) { _mm_store_ps(p, v); }
+};
+
+// only the lower half of the register is used, the upper half is zeroed on load and ignored
+template<>
+struct vec_sse<float, 2> : vec_sse_ops {
+    static constexpr bool enabled = true;
+    static constexpr size_t alignment = 8;
+
+    static inline reg load(float const* p) {
+        return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<__m64 const*>(p));
+    }
+    static inline void store(float* p, reg v) { _mm_storel_pi(reinterpret_cast<__m64*>(p), v); }
+};
+#endif
+
 // the assumption here is that vec is being used for small N
 // vec is really just meant to parallel float4/vec4 etc. seen in hlsl/glsl
 template<typename T, size_t N>
 class vec {
 private:
-    std::array<T, N> vals;
+    typedef vec_sse<T, N> sse;
+
+    alignas(sse::alignment) std::array<T, N> vals;
+
+    template<typename R>
+    static vec from_reg(R r) {
+        vec v;
+        sse::store(v.vals.data(), r);
+        return v;
+    }
+
+    inline auto reg() const { return sse::load(vals.data()); }
 
 public:
     vec() { }
@@ -38,11 +113,7 @@ public:
         });
     }
 
-    vec(vec const& other) {
-        unroll<N>([&, this](auto i) {
-            vals[i] = other[i];
-        });
-    }
+    vec(vec const& other) = default;
 
     template<typename TT>
     vec(vec<TT, N> const& other) {
@@ -57,11 +128,7 @@ public:
     vec(vec<TT, N> & other)
         : vec(const_cast<vec<TT, N> const&>(other)) { }
 
-    vec(vec&& other) {
-        unroll<N>([&, this](auto i) {
-            vals[i] = other[i];
-        });
-    }
+    vec(vec&& other) = default;
 
     template<typename TT=T, typename... Args,
         std::enable_if_t<
@@ -76,11 +143,8 @@ public:
     { static_assert(sizeof...(args)+1 == N, "# of arguments passed to full vec initialization differs from N");  }
 
 
-    void operator=(vec const& other) {
-        unroll<N>([&, this](auto i) {
-            vals[i] = other[i];
-        });
-    }
+    vec& operator=(vec const& other) = default;
+    vec& operator=(vec&& other) = default;
 
     template<typename TT>
     void operator=(vec<TT, N> const& other) {
@@ -101,6 +165,9 @@ public:
     inline T& operator[](size_t idx) { 
         assert(idx < N);return vals[idx]; }
 
+    inline T const* data() const { return vals.data(); }
+    inline T* data() { return vals.data(); }
+
 
 #define SCALAR_OP(op)                                            \
     template<typename TT, typename VT, size_t M> \
@@ -126,30 +193,34 @@ public:
 #undef VEC_OP    
 
 
-#define SCALAR_OPEQ(op)                                                  \
+#define SCALAR_OPEQ(op, simd)                                            \
     template<typename TT> \
     vec& operator op (TT val) {                         \
+        if constexpr (sse::enabled && std::is_same<TT, T>::value) \
+            return *this = from_reg(sse::simd(reg(), sse::set1(val))); \
         unroll<N>([&, this](auto i) { vals[i] op val; }); \
         return *this; \
     }
-    SCALAR_OPEQ(+=)
-    SCALAR_OPEQ(-=)
-    SCALAR_OPEQ(*=)
-    SCALAR_OPEQ(/=)
-#undef VEC_OPEQ 
+    SCALAR_OPEQ(+=, add)
+    SCALAR_OPEQ(-=, sub)
+    SCALAR_OPEQ(*=, mul)
+    SCALAR_OPEQ(/=, div)
+#undef SCALAR_OPEQ
 
 // todo consider allowing automatic type deduction here, so that thinks like:
 // (int4)v * (float4)w works and deduces to floating type.
-#define VEC_OPEQ(op)                                                  \
+#define VEC_OPEQ(op, simd)                                            \
     template<typename TT> \
     vec& operator op (vec<TT, N> const& other)  {                         \
+        if constexpr (sse::enabled && std::is_same<TT, T>::value) \
+            return *this = from_reg(sse::simd(reg(), other.reg())); \
         unroll<N>([&, this](auto i) { vals[i] op other.vals[i]; }); \
         return *this; \
     }
-    VEC_OPEQ(+=)
-    VEC_OPEQ(-=)
-    VEC_OPEQ(*=)
-    VEC_OPEQ(/=)
+    VEC_OPEQ(+=, add)
+    VEC_OPEQ(-=, sub)
+    VEC_OPEQ(*=, mul)
+    VEC_OPEQ(/=, div)
 #undef VEC_OPEQ 
 
     // todo try and add slices later, for a reference version of get
@@ -235,6 +306,10 @@ public:
     }
 
     vec clamp(T min, T max) const {
+        // std::clamp keeps v when it compares false against both bounds, e.g., NaN
+        if constexpr (sse::enabled)
+            return from_reg(sse::min(sse::set1(max), sse::max(sse::set1(min), reg())));
+
         vec w;
         unroll<N>([&, this](auto i) {
             w[i] = std::clamp(vals[i], min, max);
@@ -271,12 +346,19 @@ public:
     }
 
     static vec abs(vec const& v) {
+        if constexpr (sse::enabled)
+            return from_reg(sse::abs(v.reg()));
+
         vec vabs;
         unroll<N>([&](auto i) { vabs[i] = std::abs(v[i]); });
         return vabs;
     }
 
     static vec max(vec const& v1, vec const& v2) {
+        // std::max(v1, v2) is v1 < v2 ? v2 : v1
+        if constexpr (sse::enabled)
+            return from_reg(sse::max(v2.reg(), v1.reg()));
+
         vec w;
         unroll<N>([&](auto i) { w[i] = std::max(v1[i], v2[i]); });
         return w;
@@ -286,18 +368,29 @@ public:
 
     // w >= v ? 1 : 0
     static vec step(vec const& v, vec const& w) {
+        if constexpr (sse::enabled)
+            return from_reg(sse::step(w.reg(), v.reg()));
+
         vec stepped;
         unroll<N>([&](auto i) { stepped[i] = w[i] >= v[i] ? 1 : 0; });
         return stepped;
     }
 
     static vec step(T v, vec const& w) {
+        if constexpr (sse::enabled)
+            return from_reg(sse::step(w.reg(), sse::set1(v)));
+
         vec stepped;
         unroll<N>([&](auto i) { stepped[i] = w[i] >= v ? 1 : 0; });
         return stepped;
     }
 
     static vec lerp(float t, vec const& from, vec const& to) {
+        if constexpr (sse::enabled) {
+            auto f = from.reg();
+            return from_reg(sse::add(sse::mul(sse::sub(to.reg(), f), sse::set1(t)), f));
+        }
+
         vec lerped;
         unroll<N>([&](auto i) { lerped[i] = (to[i] - from[i]) * t + from[i]; });
         return lerped;
@@ -319,39 +412,50 @@ std::ostream& operator<<(std::ostream& out, vec<T, N> v) {
 template<typename T, typename... Args>
 vec(T v, Args&&... args) -> vec<T, sizeof...(Args)+1>;
 
-#define SCALAR_OP(op) \
+// the SSE paths only kick in when the scalar has the vec's own type, mixed types keep the implicit
+// promotions of the plain loops (e.g., float4 * 0.5 is computed in double precision)
+#define SCALAR_OP(op, simd) \
 template<typename TT, typename VT, size_t M> \
 vec<VT, M> operator op (vec<VT, M> const& v, TT const& val) { \
+    typedef typename vec<VT, M>::sse sse; \
+    if constexpr (sse::enabled && std::is_same<TT, VT>::value) \
+        return vec<VT, M>::from_reg(sse::simd(v.reg(), sse::set1(val))); \
     vec<VT, M> w; \
     unroll<M>([&](auto i) { w.vals[i] = v.vals[i] op val; }); \
     return w; \
 } \
 template<typename TT, typename VT, size_t M> \
 vec<VT, M> operator op (TT const& val, vec<VT, M> const& v) { \
+    typedef typename vec<VT, M>::sse sse; \
+    if constexpr (sse::enabled && std::is_same<TT, VT>::value) \
+        return vec<VT, M>::from_reg(sse::simd(sse::set1(val), v.reg())); \
     vec<VT, M> w; \
     unroll<M>([&](auto i) { w.vals[i] = val op v.vals[i]; }); \
     return w; \
 }
-SCALAR_OP(+)
-SCALAR_OP(-)
-SCALAR_OP(*)
-SCALAR_OP(/)
+SCALAR_OP(+, add)
+SCALAR_OP(-, sub)
+SCALAR_OP(*, mul)
+SCALAR_OP(/, div)
 #undef SCALAR_OP
 
-#define VEC_OP(op) \
+#define VEC_OP(op, simd) \
 template<typename T1, typename T2, size_t M> \
 auto operator op (vec<T1, M> const& v1, vec<T2, M> const& v2) \
     -> vec<std::decay_t<decltype(T1() op T2())>, M> { \
+    typedef typename vec<T1, M>::sse sse; \
+    if constexpr (sse::enabled && std::is_same<T1, T2>::value) \
+        return vec<T1, M>::from_reg(sse::simd(v1.reg(), v2.reg())); \
     vec<std::decay_t<decltype(T1() op T2())>, M> w; \
     unroll<M>([&](auto i) { w.vals[i] = v1.vals[i] op v2.vals[i]; }); \
     return w; \
 }
-VEC_OP(+)
-VEC_OP(-)
+VEC_OP(+, add)
+VEC_OP(-, sub)
 // even though this may make no sense in the lin.alg. world, here we just assume that all
 // vector operators are element-wise
-VEC_OP(*)
-VEC_OP(/)
+VEC_OP(*, mul)
+VEC_OP(/, div)
 #undef VEC_OP
 
 
@@ -19,6 +19,8 @@ struct vector3 {
     vector3(const vector3& other)
         : x(other.x), y(other.y), z(other.z) { }
 
+    vector3& operator=(const vector3& other) = default;
+
 #define VEC_OP(op) \
     vector3 operator op (const vector3& other) const { \
         return vector3(x op other.x, y op other.y, z op other.z); \
@@ -78,4 +80,5 @@ struct std::hash<vector3<T>> {
     }
 };
 
-typedef vector3<double> dvec3;
\ No newline at end of file
+typedef vector3<double> dvec3;
+typedef vector3<long long> ivec3;
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common.h"
+#include "math_utils.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// nearest site lookups for Voronoi graphs, the native counterpart of find_nearest in voronoi.lua.
+// Sites are binned into a uniform grid of about one site per bin, and every lookup searches the
+// bins around its own ring by ring, until no bin further out can hold a closer site. That makes a
+// lookup about constant time rather than linear in the number of sites.
+class site_grid {
+  std::vector<double> xs, ys;
+  DISTANCE_FUNC distance_func;
+
+  double left = 0, top = 0; // position of the first bin
+  double bin = 1;           // width and height of every bin
+  long long cols = 1, rows = 1;
+
+  // sites of bin b are order[starts[b]], ..., order[starts[b + 1] - 1], in the order they were
+  // given in
+  std::vector<size_t> starts;
+  std::vector<size_t> order;
+
+  // distance that nearest compares sites by, the squared distance for Euclidian so that it
+  // doesn't need a sqrt
+  inline double rank_of(double dx, double dy) const {
+    return distance_func == MANHATTAN ? std::fabs(dx) + std::fabs(dy) : dx * dx + dy * dy;
+  }
+
+public:
+  // throws std::invalid_argument if there are no sites or xs and ys aren't the same size
+  site_grid(std::vector<double> xs, std::vector<double> ys, DISTANCE_FUNC distance_func);
+
+  inline size_t size() const { return xs.size(); }
+  inline double site_x(size_t i) const { return xs[i]; }
+  inline double site_y(size_t i) const { return ys[i]; }
+
+  // index of the site closest to x, y. Ties go to the site that was given first, same as
+  // find_nearest
+  size_t nearest(double x, double y) const;
+};
+
+// index (from 1) of the site nearest to every pixel of a width * height area, where the top left
+// pixel is at left, top. Rows are split over the thread pool
+void voronoi_graph(site_grid const& grid, size_t width, size_t height, double left, double top,
+                   double out[]);
+
+// libnoise.voronoi{sites, width, height, left = 0, top = 0, distance_func = DISFUNCS.Euclidian,
+// centroids = false}
+//
+// sites is a table of {x, y} tables. Returns an ldarray of width * height site indices (from 1),
+// row by row. left and top offset every pixel, so that the padded area of voronoi.lua (expand) can
+// be given directly. With centroids = true, also returns a table of the {x, y} centroid of the
+// pixels of every site, where sites without pixels stay where they are
+int l_voronoi(lua_State* L);
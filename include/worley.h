@@ -1,10 +1,13 @@
 #pragma once
 
 #include "common.h"
+#include "larray.h"
+#include "lattice.h"
+#include "lattice3.h"
 #include "math_utils.h"
 #include "vector3.h"
 
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 // cap n at 9, technically can be greater but if 1 per cell, 9 is the max we can guarantee
@@ -15,6 +18,30 @@ class Worley {
 public:
   typedef std::vector<double> result_t;
 
+  typedef std::vector<dvec3> points_t;
+
+  // generates the points of a cell, seeded by the cell's position on the lattice. Points are
+  // relative to the cell's corner, so that cells which wrap to the same cell can share them
+  struct point_generator {
+    lattice3 ltc;
+    double mean_points;
+
+    points_t operator()(lattice_cell<3> const& cell) const;
+  };
+
+  typedef lattice<3, points_t, point_generator> cache_t;
+  typedef periodic_lattice<3, points_t, point_generator> periodic_cache_t;
+
+  // caps the number of cells precomputed for looping noise, past it cells are generated per frame
+  static constexpr size_t MAX_PERIODIC_CELLS = 1 << 20;
+
+  // whether ltc loops along every axis, with few enough cells to precompute all of them. Worley
+  // and worley_octave both use the periodic cache if so, and the other one otherwise
+  static bool is_periodic(lattice3 const& ltc);
+  // empty cache covering every cell that a width * height frame can reach
+  static cache_t make_cache(lattice3 const& ltc, double width, double height, double mean_points);
+  static periodic_cache_t make_periodic_cache(lattice3 const& ltc, double mean_points);
+
 private:
   int seed = 0;
   double width = 0;  // width: double -- width in pixels
@@ -31,6 +58,10 @@ private:
   INTERPOLATE_FUNC movement_func =
       LERP;   // movement_func: string/enum or function -- lerp, cerp, etc.
   dvec3 freq; // how often to loop, 0 if none
+  ARRAY_TYPE array_type =
+      ARRAY_DOUBLE; // array_type: enum -- element type of the returned larrays
+
+  lattice_stats cache_stats; // of the cell cache used by the last compute, since it was built
 
   // colors: table -- colors to use
   // clamp: double -- largest distance to keep, 0 for no clamp
@@ -40,23 +71,64 @@ private:
 
   size_t get_result_size() const;
 
-  typedef std::vector<dvec3> points_t;
-  typedef std::unordered_map<dvec3, points_t> cache_t;
+  // seeded lattice of the cells
+  lattice3 get_lattice() const;
+
+  // everything the cells in a cache depend on, if any of these change the cache is thrown away
+  struct cache_key {
+    int seed;
+    double cellsize;
+    double mean_points;
+    dvec3 freq;
+    double width;
+    double height;
+
+    bool operator==(cache_key const& other) const;
+  };
+
+  cache_key get_cache_key() const;
+
+  // cells kept between computes, only one of the two is in use at a time
+  cache_key cached_for{};
+  std::unique_ptr<cache_t> cell_cache;
+  std::unique_ptr<periodic_cache_t> periodic_cell_cache;
+
+  // drops the cached cells if they no longer match the current properties
+  void validate_cache();
+
+  // reads the properties given in the table at stack index idx, leaving the others as they are
+  void load_options(lua_State* L, int idx);
 
   // computes Worley noise given the current properties and fills a vector with
-  // them
-  template<size_t N>
-  result_t compute_frame(cache_t& cache, double z) const;
+  // them, cache is either a cache_t or a periodic_cache_t
+  template<size_t N, typename Cache>
+  result_t compute_frame(Cache& cache, double z) const;
+
+  // computes Worley noise and fills the given array with them, converting each distance to the
+  // array's element type
+  template<size_t N, typename T, typename Cache>
+  void compute_frame(Cache& cache, double z, T values[]) const;
 
-  // computes Worley noise and fills the given array with them
-  template<size_t N>
-  void compute_frame(cache_t& cache, double z, double values[]) const;
+  // computes every frame into the table at stack index into, reusing the larrays already in it
+  // where they match the result type and size, and returns it
+  static int compute_frames(lua_State* L, Worley* worley, int into);
 
 public:
   std::string to_string() const;
 
   static int lnew(lua_State* L);
+  // W:set{...}, changes any of the properties given to the constructor and returns W. Cells are
+  // kept for the next compute unless seed, cellsize, mean_points, loops, width or height change
+  static int set(lua_State* L);
+  static int gc(lua_State* L);
   static int compute(lua_State* L);
+  // W:compute_into(frames), same as compute but fills (and returns) the given table of frames,
+  // which allows the larrays of a previous call to be recycled
+  static int compute_into(lua_State* L);
+  // W:cache_stats(), table of the lattice_stats of the cell cache as of the last compute, counted
+  // since the cache was last invalidated, i.e., { generated, evicted, recycled, peak_slabs,
+  // peak_cells }
+  static int get_cache_stats(lua_State* L);
   static int to_string(lua_State* L);
   static void register_class(lua_State* L);
 };
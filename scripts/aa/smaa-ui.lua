@@ -1,6 +1,8 @@
 local utils = require("utils")
 
 local SMAA_defs = {
+    edge_detection = "Color", -- { "Color", "Luma" }
+    incremental = true, -- only recompute what changed between frames when applying to all frames
 }
 
 local function SMAA_dlog(parent, defs)
@@ -8,7 +10,11 @@ local function SMAA_dlog(parent, defs)
     title = "SMAA Options",
     parent = parent
   }
-  dlog:label { id = "label", label = "No parameters (yet)" }
+  dlog:combobox { id = "edge_detection", label = "Edge Detection",
+        option = defs.edge_detection,
+        options = { "Color", "Luma" }
+      }
+      :check { id = "incremental", label = "Incremental (Animation)", selected = defs.incremental }
       :button { id = "ok", text = "OK", focus = true }
       :button { id = "cancel", text = "Cancel" }
       :show()
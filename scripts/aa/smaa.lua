@@ -42,14 +42,44 @@ local function paint_SMAA(sp, opts, mopts)
     -- note a value of nil to paint_over just uses all active frames
     if opts.all_frames then frames = nil end
 
+    local smaa_opts = { }
+    if libnoise then
+        smaa_opts.edge_detection = libnoise.SMAA_EDGE_DETECTION[mopts.edge_detection]
+        smaa_opts.incremental = mopts.incremental
+        -- colors are painted as 8-bit channels anyway
+        smaa_opts.array_type = libnoise.ARRAY_TYPES and libnoise.ARRAY_TYPES.U8
+    end
+
+    if libnoise and libnoise.SMAA_batch then
+        -- resolve the frames once, since reading and painting below need to agree on them
+        frames = frames or sp:get_active_frames()
+
+        -- gather every frame first so that they can all be filtered at once natively, reading
+        -- doesn't create cels so each frame still gets a single new cel when painted below
+        local originals = { }
+        for i, frame in ipairs(frames) do
+            sp:read_frame(frame)
+            originals[i] = sp:to_bytes() or sp:to_buffer().elements
+        end
+
+        local arrs = libnoise.SMAA_batch(sp.width, sp.height, originals, smaa_opts)
+
+        for finfo in sp:paint_over(frames) do
+            sp:from_arr(arrs[finfo.idx])
+        end
+
+        return
+    end
+
     for finfo in sp:paint_over(frames) do
         local original = sp:to_buffer()
-        local arr = SMAA(sp.width, sp.height, original.elements, {})
+        local arr = SMAA(sp.width, sp.height, original.elements, smaa_opts)
         sp:from_arr(arr)
     end
 end
 
 return {
     SMAA = libnoise and libnoise.SMAA or SMAA,
+    SMAA_batch = libnoise and libnoise.SMAA_batch,
     paint_SMAA = paint_SMAA,
 }
\ No newline at end of file
@@ -2,8 +2,14 @@ app = app -- stfu lsp
 Dialog = Dialog
 Point = Point
 Color = Color
+Image = Image
 ColorMode = ColorMode
 ldarray = ldarray
+lfarray = lfarray
+lbarray = lbarray
+lwarray = lwarray
+luarray = luarray
+larray = larray
 Worley = Worley
 
 
@@ -15,6 +15,7 @@ local perlin_defs = {
     movement = 1, -- movement over the full animation (in cellsizes)
     octaves = 1, -- iterations of noise function to add "detail" to the noise at an exponentially
                  -- decreasing scale
+    simplex = false, -- use simplex noise (3 or 4 corners per pixel rather than 4 or 8), native only
 
     scale_range = false, -- should the output range be scaled to its absolute min and absolute max
                         -- perlin noise very rarely reaches -1 or 1, so this will take the outputted
@@ -34,6 +35,7 @@ local function perlin_dlog(parent, defs)
   dlog:number { id = "cellsize", label = "Cell Size [0,\\infin]", decimals=3, 
                 text = tostring(defs.cellsize) }
       :number { id = "octaves", label = "Octaves", decimals=0, text = tostring(defs.octaves) }
+      :check { id = "simplex", label = "Simplex Noise", selected = defs.simplex }
       :check { id = "scale_range", label = "Scale Range", selected = defs.scale_range }
       :check { id = "fixed", label = "Fixed Colors", selected = defs.fixed }
       :check { id = "threed", label = "3D Noise (Animate)", selected = defs.threed, onclick = function()
@@ -1,4 +1,6 @@
 local utils = require("utils")
+-- registers the native Perlin class, if the library is available
+local libnoise = utils.try_load_dlib("libnoise")
 
 local pi2 = 2*math.pi
 
@@ -55,19 +57,42 @@ local function gen_grad3d(seed, size)
     return grad
 end
 
-local fixed_grad = gen_grad(tonumber(os.time()), 256*256)
-local fixed_grad3d = gen_grad3d(tonumber(os.time()), 256*256)
+-- the gradient tables are only built on first use, natively (see libnoise.gradient_table) when the
+-- library is available. Each way uses a fixed seed, so a noise seed always gives the same noise on
+-- the same path. The native table (std::mt19937) and the Lua one (math.random) differ though, so
+-- the same seed gives different noise depending on whether libnoise loaded
+local GRAD_SEED = 0x5EED6AD
+local fixed_grad = nil
+local fixed_grad3d = nil
+
+local function get_fixed_grad()
+    if not fixed_grad then
+        fixed_grad = (libnoise and libnoise.gradient_table and libnoise.gradient_table(2))
+            or gen_grad(GRAD_SEED, 256*256)
+    end
+    return fixed_grad
+end
+
+local function get_fixed_grad3d()
+    if not fixed_grad3d then
+        fixed_grad3d = (libnoise and libnoise.gradient_table and libnoise.gradient_table(3))
+            or gen_grad3d(GRAD_SEED, 256*256)
+    end
+    return fixed_grad3d
+end
 
 local function random_grad_fixed(seed, cx, cy)
+    local grad = get_fixed_grad()
     math.randomseed(seed*cx, seed*cy)
-    local idx = math.floor(math.random()*(#fixed_grad/2))+1
-    return { x = fixed_grad[idx], y = fixed_grad[idx+1] }
+    local idx = math.floor(math.random()*(#grad/2))+1
+    return { x = grad[idx], y = grad[idx+1] }
 end
 
 local function random_grad3d_fixed(seed, cx, cy, cz)
+    local grad = get_fixed_grad3d()
     math.randomseed(seed*cx + cz, seed*cy + cz)
-    local idx = math.floor(math.random()*(#fixed_grad3d/3))+1
-    return { x = fixed_grad3d[idx], y = fixed_grad3d[idx+1], z = fixed_grad3d[idx+2] }
+    local idx = math.floor(math.random()*(#grad/3))+1
+    return { x = grad[idx], y = grad[idx+1], z = grad[idx+2] }
 end
 
 local function random_grad_native(seed, cx, cy)
@@ -278,34 +303,71 @@ local function paint_perlin(sp, opts, mopts)
 
     local frames = mopts.threed and mopts.frames or 1
 
-    local graphs = perlin {
-        seed = opts.seed,
-        dimensions = mopts.threed and 3 or 2,
-        movement = mopts.movement,
-        cellsize = mopts.cellsize,
-        width = sp.width,
-        height = sp.height,
-        frames = frames,
-        octaves = mopts.octaves,
-        loop = {
-            loopx = mopts.loop and mopts.loopx and sp.width / mopts.cellsize,
-            loopy = mopts.loop and mopts.loopy and sp.height / mopts.cellsize,
-            loopz = mopts.loop and mopts.loopz and mopts.movement,
-        },
-    }
+    local loopx = mopts.loop and mopts.loopx and sp.width / mopts.cellsize
+    local loopy = mopts.loop and mopts.loopy and sp.height / mopts.cellsize
+    local loopz = mopts.loop and mopts.loopz and mopts.movement
+
+    local graphs = nil
+    local first = 0 -- perlin() fills its graphs from 0, larrays start at 1
+
+    if Perlin and not use_lua then
+        local options = {
+            seed = opts.seed,
+            width = sp.width,
+            height = sp.height,
+            length = frames,
+            cellsize = mopts.cellsize,
+            octaves = mopts.octaves,
+            dimensions = mopts.threed and 3 or 2,
+            movement = mopts.movement,
+            loops = { x = loopx or 0, y = loopy or 0, z = loopz or 0 },
+        }
 
-    local color = nil
+        if mopts.simplex and Fractal then
+            -- same octaves as Perlin, each one halving the cellsize and weight of the previous one
+            options.base = libnoise.BASE_NOISES.Simplex
+            options.lacunarity = 2
+            options.gain = 0.5
+            graphs = Fractal(options):compute()
+        else
+            graphs = Perlin(options):compute()
+        end
+        first = 1
 
-    if mopts.scale_range then
-        for g=1, #graphs do
-            graphs[g] = utils.scale(graphs[g], 0, -1, 1)
+        if mopts.scale_range then
+            for g=1, #graphs do
+                local graph = graphs[g]
+                local lo, hi = graph:min(), graph:max()
+                if hi > lo then graph:map_range(lo, hi, -1, 1) end
+            end
+        end
+    else
+        -- simplex noise is only native, so this is always Perlin noise
+        graphs = perlin {
+            seed = opts.seed,
+            dimensions = mopts.threed and 3 or 2,
+            movement = mopts.movement,
+            cellsize = mopts.cellsize,
+            width = sp.width,
+            height = sp.height,
+            frames = frames,
+            octaves = mopts.octaves,
+            loop = { loopx = loopx, loopy = loopy, loopz = loopz },
+        }
+
+        if mopts.scale_range then
+            for g=1, #graphs do
+                graphs[g] = utils.scale(graphs[g], 0, -1, 1)
+            end
         end
     end
 
+    local color = nil
+
     local grad = opts.grad
 
     for pixel in sp:animate(frames) do
-          local val = graphs[pixel.frame][pixel.idx]
+          local val = graphs[pixel.frame][pixel.idx + first]
           val = val * 0.5 + 0.5   -- normalize
 
           if mopts.fixed then
@@ -193,6 +193,20 @@ function SpritePainter:load_frame(idx)
     end
 end
 
+-- points the painter at a sprite sized copy of frame idx, for reading only. Unlike load_frame this
+-- doesn't create a cel, so it adds no undo step. Load the frame before painting it
+function SpritePainter:read_frame(idx)
+    self.image = Image(self.sprite.spec)
+
+    local cel = self.use_active_layer and self.layer:cel(idx)
+    if cel then
+        self.image:drawImage(cel.image, cel.position)
+    end
+
+    -- the copy covers the whole sprite, so positions don't need adjusting
+    self.cel = { position = Point(0, 0) }
+end
+
 function SpritePainter:put_pixel(x, y, color)
     local xadj = x - self.cel.position.x
     local yadj = y - self.cel.position.y
@@ -237,7 +251,41 @@ function SpritePainter:from_buffer(buffer)
     end
 end
 
+-- Image.bytes is only available in newer Aseprite versions, checked once on a throwaway image
+local bytes_supported = nil
+local function has_image_bytes()
+    if bytes_supported == nil then
+        local ok, bytes = pcall(function() return Image(1, 1).bytes end)
+        bytes_supported = ok and bytes ~= nil
+    end
+    return bytes_supported
+end
+
+-- whether the current image can be read/written as a whole through Image.bytes, which requires an
+-- RGB image that covers the whole sprite
+function SpritePainter:can_use_bytes()
+    if self.sprite.colorMode ~= ColorMode.RGB then return false end
+    if self.cel.position.x ~= 0 or self.cel.position.y ~= 0 then return false end
+    if self.image.width ~= self.width or self.image.height ~= self.height then return false end
+
+    return has_image_bytes()
+end
+
+-- RGBA bytes of the current frame, or nil if they can't be read directly
+function SpritePainter:to_bytes()
+    if self:can_use_bytes() then
+        return self.image.bytes
+    end
+end
+
 function SpritePainter:from_arr(arr)
+    -- native arrays can be packed into the image in a single call, masks are applied per pixel so
+    -- they still need the slow path
+    if not self.lock_alpha and type(arr) == "userdata" and arr.to_bytes and self:can_use_bytes() then
+        self.image.bytes = arr:to_bytes("rgba")
+        return
+    end
+
     local idx = 1
     for pixel in self:pixels() do
         pixel:put(Color{
@@ -1,4 +1,5 @@
 local utils = require("utils")
+local libnoise = utils.try_load_dlib("libnoise")
 
 local voronoi_opt_defaults = {
   colors = 2,
@@ -52,6 +53,15 @@ local function voronoi_graph(points, width, height, dfunc, offsetx, offsety)
   return graph
 end
 
+-- libnoise.DISFUNCS value of a distance function, nil for any but the ones the native graph knows
+local function native_distance(dfunc)
+  if not (libnoise and libnoise.voronoi) or use_lua then return nil end
+
+  if dfunc == utils.dist2 then return libnoise.DISFUNCS.Euclidian end
+  if dfunc == utils.mh_dist2 then return libnoise.DISFUNCS.Manhattan end
+  return nil
+end
+
 -- todo: add rounded option, take on color out of the mix and add that to edges / bg
 -- todo: add antialias flag
 
@@ -77,16 +87,32 @@ local function voronoi(seed, width, height, length, options, loop)
     points[i] = { math.random() * pwidth + pleft, math.random() * pheight + ptop }
   end
 
+  local native = native_distance(options.distance_func)
+
   -- relax the points
   if options.relax then
     for i = 1, options.relax_steps do
-      local graph = voronoi_graph(points, pwidth, pheight, options.distance_func, pleft, ptop)
-
-      points = {}        -- reset points
-      -- instead of trying to do an exact computation of the centroid, discreteze the space into
-      -- pixels and just average those
-      for p = 1, #graph do
-        points[p] = utils.centroid(graph[p])
+      if native then
+        -- centroid of the pixels nearest to each site over the padded area
+        local _, centroids = libnoise.voronoi {
+          sites = points,
+          width = math.floor(pwidth),
+          height = math.floor(pheight),
+          left = pleft,
+          top = ptop,
+          distance_func = native,
+          centroids = true,
+        }
+        points = centroids
+      else
+        local graph = voronoi_graph(points, pwidth, pheight, options.distance_func, pleft, ptop)
+
+        points = {}        -- reset points
+        -- instead of trying to do an exact computation of the centroid, discreteze the space into
+        -- pixels and just average those
+        for p = 1, #graph do
+          points[p] = utils.centroid(graph[p])
+        end
       end
     end
   end
@@ -160,15 +186,28 @@ local function voronoi(seed, width, height, length, options, loop)
     end
 
     -- generate the actual graph with the interpolated points
-    local graph = voronoi_graph(points, width, height, options.distance_func)
-    for p = 1, #graph do
-      local color = pcolors[p]
-      local pixels = graph[p]
-
-      -- iterate over each pixel contained in point p's set and assign its colors in the image
-      for i = 1, #pixels do
-        local pixel = pixels[i]
-        img[width * pixel[2] + pixel[1]] = color
+    if native then
+      -- site index of every pixel, the ldarray starts at 1 where img starts at 0
+      local graph = libnoise.voronoi {
+        sites = points,
+        width = width,
+        height = height,
+        distance_func = native,
+      }
+      for i = 0, width * height - 1 do
+        img[i] = pcolors[graph[i + 1]]
+      end
+    else
+      local graph = voronoi_graph(points, width, height, options.distance_func)
+      for p = 1, #graph do
+        local color = pcolors[p]
+        local pixels = graph[p]
+
+        -- iterate over each pixel contained in point p's set and assign its colors in the image
+        for i = 1, #pixels do
+          local pixel = pixels[i]
+          img[width * pixel[2] + pixel[1]] = color
+        end
       end
     end
 
@@ -207,6 +207,9 @@ local function worley(seed, width, height, length, options)
     return graphs
 end
 
+-- native Worley object of the last run, see paint_worley
+local native_worley = nil
+
 local function paint_worley(sp, opts, mopts)
     sp.layer.name = "Worley Noise"
 
@@ -236,7 +239,7 @@ local function paint_worley(sp, opts, mopts)
     end
 
     if Worley and not use_lua then
-      local W = Worley {
+      local params = {
         seed = opts.seed,
         width = sp.width,
         height = sp.height,
@@ -248,8 +251,19 @@ local function paint_worley(sp, opts, mopts)
         movement = mopts.movement,
         movement_func = libnoise.ERPFUNCS[mopts.movement_func],
         loops = loop,
+        -- distances don't need double precision
+        array_type = libnoise.ARRAY_TYPES and libnoise.ARRAY_TYPES.Float,
       }
 
+      -- reuse the object between runs, it keeps its cells unless the seed, cellsize, mean points,
+      -- loops or sprite size change
+      if native_worley and native_worley.set then
+        native_worley:set(params)
+      else
+        native_worley = Worley(params)
+      end
+      local W = native_worley
+
       graphs = W:compute()
 
       --print(W)
@@ -261,11 +275,8 @@ local function paint_worley(sp, opts, mopts)
         local new_graph = { }
         
         for i=1,#graph,n do
-          local item = { }
-          for j=i,i+n-1 do
-            table.insert(item, graph[j])
-          end
-          table.insert(new_graph, item)
+          -- one native call per item rather than one per distance
+          table.insert(new_graph, { graph:unpack(i, i+n-1) })
         end
 
         graphs[g] = new_graph
@@ -14969,4 +14969,6 @@ static const std::array<unsigned char, AREATEX_SIZE> areaTexBytes = {
 fbuffer2 area_buffer = fbuffer2::scale(fbuffer2(
     AREATEX_WIDTH, AREATEX_HEIGHT, vec<float,2>(0.0f),
     areaTexBytes.begin(), areaTexBytes.end(), false, false
-), 1.0f/255.0f);
\ No newline at end of file
+), 1.0f/255.0f);
+
+lut8<2> area_lut(AREATEX_WIDTH, AREATEX_HEIGHT, areaTexBytes.begin(), areaTexBytes.end());
@@ -121,4 +121,6 @@ static const std::array<unsigned char, SEARCHTEX_SIZE> searchTexBytes = {
 fbuffer1 search_buffer = fbuffer1::scale(fbuffer1(
     SEARCHTEX_WIDTH, SEARCHTEX_HEIGHT, vec<float,1>(0.0f),
     searchTexBytes.begin(), searchTexBytes.end(), false, false
-), 1.0f/255.0f);
\ No newline at end of file
+), 1.0f/255.0f);
+
+lut8<1> search_lut(SEARCHTEX_WIDTH, SEARCHTEX_HEIGHT, searchTexBytes.begin(), searchTexBytes.end());
@@ -0,0 +1,408 @@
+#include "base_noise.h"
+
+#include "gradient_noise.h"
+#include "math_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+const char* BASE_NOISE_NAMES[] = {
+  "Perlin",
+  "Value",
+  "Worley",
+  "Simplex",
+};
+
+static constexpr double PI2 = 6.283185307179586;
+
+// 3D simplex noise peaks at a single corner, at (0.5 - 1/18)^4 * sqrt(1/18) ~ 0.0092, this brings
+// it to about [-1, 1]
+static constexpr double SIMPLEX3_SCALE = 105.0;
+
+// unit gradient of a lattice corner, picked by the corner's seed. 2D gradients are spread evenly
+// over the circle, 3D ones over the sphere
+static inline dvec3 gradient_of(uint64_t h, bool threed) {
+  if (!threed) {
+    double r = (double)(h >> 11) * 0x1p-53 * PI2;
+    return dvec3(std::cos(r), std::sin(r), 0);
+  }
+
+  double z = (double)(h >> 32) * 0x1p-32 * 2 - 1;
+  double phi = (double)(h & 0xffffffff) * 0x1p-32 * PI2;
+  double r = std::sqrt(1 - z * z);
+  return dvec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// random value of a lattice corner in [-1, 1), picked by the corner's seed
+static inline double value_of(uint64_t h) { return (double)(h >> 11) * 0x1p-53 * 2 - 1; }
+
+// dot(dist(corner, point), grad)
+static inline double dot_grad(dvec3 const& g, double dx, double dy, double dz) {
+  return dx * g.x + dy * g.y + dz * g.z;
+}
+
+static std::vector<long long> column_cells(lattice3 const& ltc, size_t width) {
+  std::vector<long long> xcells(width);
+  ltc.cells_along(0, xcells.size(), xcells.data());
+  return xcells;
+}
+
+// f(corner) of every corner that a row touches, looked up once per cell rather than per pixel.
+// Corners of column k (relative to the first column's cell) are at [k*layers + dz*2 + dy]
+template <typename T, typename F>
+static std::vector<T> row_corners(lattice3 const& ltc, std::vector<long long> const& xcells,
+                                  long long cy, long long cz, size_t layers, F&& f) {
+  long long x0 = xcells.front();
+  size_t columns = (size_t)(xcells.back() + 1 - x0) + 1;
+
+  std::vector<T> corners(columns * layers);
+  for (size_t k = 0; k < columns; k++)
+    for (size_t dz = 0; dz < layers / 2; dz++)
+      for (size_t dy = 0; dy < 2; dy++) {
+        ivec3 corner(x0 + (long long)k, cy + (long long)dy, cz + (long long)dz);
+        corners[k * layers + dz * 2 + dy] = f(ltc.cell_seed(corner));
+      }
+
+  return corners;
+}
+
+gradient_octave::gradient_octave(lattice3 const& ltc, size_t width, bool threed)
+    : ltc(ltc), threed(threed), xcells(column_cells(ltc, width)) {}
+
+void gradient_octave::row(double y, double z, double values[]) const {
+  if (xcells.empty())
+    return;
+
+  double cs = ltc.get_cellsize();
+
+  // how far into the cell we are, in cells
+  long long cy = ltc.cell_of(y);
+  long long cz = threed ? ltc.cell_of(z) : 0;
+  double fy = y / cs - cy;
+  double fz = threed ? z / cs - cz : 0;
+  double v = smootherstep(0.0, 1.0, fy);
+  double w = smootherstep(0.0, 1.0, fz);
+
+  size_t layers = threed ? 4 : 2;
+  std::vector<dvec3> grads = row_corners<dvec3>(
+      ltc, xcells, cy, cz, layers, [&](uint64_t h) { return gradient_of(h, threed); });
+
+  long long x0 = xcells.front();
+  for (size_t x = 0; x < xcells.size(); x++) {
+    double fx = x / cs - xcells[x];
+    double u = smootherstep(0.0, 1.0, fx);
+
+    dvec3 const* g0 = &grads[(size_t)(xcells[x] - x0) * layers];
+    dvec3 const* g1 = g0 + layers;
+
+    // top-left -> top-right, bottom-left -> bottom-right
+    double top = lerp(dot_grad(g0[0], fx, fy, fz), dot_grad(g1[0], fx - 1, fy, fz), u);
+    double bot = lerp(dot_grad(g0[1], fx, fy - 1, fz), dot_grad(g1[1], fx - 1, fy - 1, fz), u);
+
+    if (threed) {
+      // same for the back corners, then front -> back
+      double topback =
+          lerp(dot_grad(g0[2], fx, fy, fz - 1), dot_grad(g1[2], fx - 1, fy, fz - 1), u);
+      double botback =
+          lerp(dot_grad(g0[3], fx, fy - 1, fz - 1), dot_grad(g1[3], fx - 1, fy - 1, fz - 1), u);
+      top = lerp(top, topback, w);
+      bot = lerp(bot, botback, w);
+    }
+
+    values[x] = lerp(top, bot, v);
+  }
+}
+
+value_octave::value_octave(lattice3 const& ltc, size_t width, bool threed)
+    : ltc(ltc), threed(threed), xcells(column_cells(ltc, width)) {}
+
+void value_octave::row(double y, double z, double values[]) const {
+  if (xcells.empty())
+    return;
+
+  double cs = ltc.get_cellsize();
+
+  long long cy = ltc.cell_of(y);
+  long long cz = threed ? ltc.cell_of(z) : 0;
+  double v = smootherstep(0.0, 1.0, y / cs - cy);
+  double w = threed ? smootherstep(0.0, 1.0, z / cs - cz) : 0;
+
+  size_t layers = threed ? 4 : 2;
+  std::vector<double> corners = row_corners<double>(ltc, xcells, cy, cz, layers, value_of);
+
+  long long x0 = xcells.front();
+  for (size_t x = 0; x < xcells.size(); x++) {
+    double u = smootherstep(0.0, 1.0, x / cs - xcells[x]);
+
+    double const* c0 = &corners[(size_t)(xcells[x] - x0) * layers];
+    double const* c1 = c0 + layers;
+
+    double top = lerp(c0[0], c1[0], u);
+    double bot = lerp(c0[1], c1[1], u);
+    if (threed) {
+      top = lerp(top, lerp(c0[2], c1[2], u), w);
+      bot = lerp(bot, lerp(c0[3], c1[3], u), w);
+    }
+
+    values[x] = lerp(top, bot, v);
+  }
+}
+
+worley_octave::worley_octave(lattice3 const& ltc, size_t width, size_t height, double mean_points)
+    : ltc(ltc), xcells(column_cells(ltc, width)) {
+  if (Worley::is_periodic(ltc))
+    periodic_cache =
+        std::make_unique<Worley::periodic_cache_t>(Worley::make_periodic_cache(ltc, mean_points));
+  else
+    cache = std::make_unique<Worley::cache_t>(
+        Worley::make_cache(ltc, (double)width, (double)height, mean_points));
+}
+
+void worley_octave::prepare(double z) {
+  long long zcell = ltc.cell_of(z);
+
+  with_cache([&](auto& c) {
+    c.advance(zcell - 1, zcell + 1);
+    for (long long dz = -1; dz <= 1; dz++) {
+      slabs[dz + 1] = c.slab_data(zcell + dz);
+      zcorners[dz + 1] = ltc.corner_of({0, 0, zcell + dz}).z;
+    }
+  });
+}
+
+void worley_octave::row(double y, double z, double values[]) const {
+  long long cy = ltc.cell_of(y);
+
+  with_cache([&](auto const& c) {
+    size_t yoffsets[3];
+    for (long long dy = -1; dy <= 1; dy++)
+      yoffsets[dy + 1] = c.axis_offset(1, cy + dy);
+
+    for (size_t x = 0; x < xcells.size(); x++) {
+      double closest = std::numeric_limits<double>::infinity();
+
+      // the closest point is guaranteed to be in the 3x3x3 block of cells around x,y,z
+      for (size_t dx = 0; dx < 3; dx++) {
+        ivec3 cell(xcells[x] + (long long)dx - 1, cy, 0);
+        size_t xoffset = c.axis_offset(0, cell.x);
+
+        for (size_t dy = 0; dy < 3; dy++) {
+          cell.y = cy + (long long)dy - 1;
+          dvec3 corner = ltc.corner_of(cell);
+
+          for (size_t dz = 0; dz < 3; dz++) {
+            for (dvec3 const& p : slabs[dz][yoffsets[dy] + xoffset]) {
+              double d =
+                  dist3(p.x + corner.x, p.y + corner.y, p.z + zcorners[dz], (double)x, y, z);
+              closest = std::min(closest, d);
+            }
+          }
+        }
+      }
+
+      values[x] = 2 * std::min(closest / ltc.get_cellsize(), 1.0) - 1;
+    }
+  });
+}
+
+// unit gradient of a simplex corner, picked from gradient_table by the corner's seed
+static inline dvec3 table_gradient(uint64_t h, bool threed) {
+  static_assert(GRADIENT_TABLE_SIZE == (size_t)1 << 16, "gradients are picked by 16 bits of seed");
+  size_t i = (size_t)(h >> 48);
+
+  if (!threed) {
+    static std::vector<double> const& table2 = gradient_table(2);
+    return dvec3(table2[i * 2], table2[i * 2 + 1], 0);
+  }
+
+  static std::vector<double> const& table3 = gradient_table(3);
+  return dvec3(table3[i * 3], table3[i * 3 + 1], table3[i * 3 + 2]);
+}
+
+// floor that doesn't go through libm, the skewed cells change on every pixel so it is called a lot
+static inline long long floor_cell(double v) {
+  long long c = (long long)v;
+  return v < (double)c ? c - 1 : c;
+}
+
+// the period of the 2D lattice along y, rows are half a cell apart along x so it only repeats after
+// an even number of them
+static long long simplex_rows(lattice3 const& ltc, bool threed) {
+  long long rows = ltc.get_period().y;
+  return !threed && rows % 2 != 0 ? rows + 1 : rows;
+}
+
+// corners are seeded by their position in half cells, so the seeds repeat after twice the period
+static lattice3 simplex_corners(lattice3 const& ltc, bool threed) {
+  ivec3 period = ltc.get_period();
+  double rows = (double)simplex_rows(ltc, threed);
+
+  lattice3 corners(1, dvec3(2.0 * period.x, 2.0 * rows, threed ? 2.0 * period.z : 0.0));
+  corners.set_seed((unsigned int)ltc.cell_seed(ivec3(0, 0, 0)));
+  return corners;
+}
+
+simplex_octave::simplex_octave(lattice3 const& ltc, size_t width, bool threed)
+    : ltc(ltc), corners(simplex_corners(ltc, threed)), threed(threed), width(width) {
+  long long period = ltc.get_period().y;
+  if (period != 0)
+    ystretch = (double)simplex_rows(ltc, threed) / period;
+}
+
+void simplex_octave::row(double y, double z, double values[]) const {
+  if (width == 0)
+    return;
+
+  if (threed)
+    row3(y, z, values);
+  else
+    row2(y, values);
+}
+
+// a corner of the simplices that a row touches, with everything that is the same along the row
+// worked out up front
+struct simplex_corner {
+  double x;  // position along x, in cells
+  double k;  // squared distance from the row along y and z
+  double gx; // gradient along x
+  double c;  // dot product of the gradient and the distance along y and z
+};
+
+static inline simplex_corner row_corner(dvec3 const& pos, dvec3 const& grad, double yl,
+                                        double zl) {
+  double dy = yl - pos.y;
+  double dz = zl - pos.z;
+  return {pos.x, dy * dy + dz * dz, grad.x, grad.y * dy + grad.z * dz};
+}
+
+// max(r2 - d^2, 0)^4 * dot(grad, d), how much a corner adds at xl (in cells) where d is the
+// distance to it. Whether a corner is within reach is a coin flip, so this masks rather than
+// branches
+static inline double corner_noise(simplex_corner const& corner, double r2, double xl) {
+  double e = xl - corner.x;
+  double t = r2 - corner.k - e * e;
+  t *= (double)(t > 0);
+  t *= t;
+  return t * t * (corner.gx * e + corner.c);
+}
+
+// the lattice is skewed by (u, v) = (x + y/2, y), corner (i, j) is at (i - j/2, j) in cells
+void simplex_octave::row2(double y, double values[]) const {
+  double cs = ltc.get_cellsize();
+
+  double yl = y / cs * ystretch;
+  long long j0 = floor_cell(yl);
+  double fv = yl - j0;
+
+  // both rows of corners that the row touches, [(i - imin) * 2 + (j - j0)]
+  long long imin = floor_cell(0.0 / cs + 0.5 * yl);
+  long long imax = floor_cell((double)(width - 1) / cs + 0.5 * yl);
+  std::vector<simplex_corner> cached((size_t)(imax + 2 - imin) * 2);
+  for (long long i = imin; i <= imax + 1; i++)
+    for (long long dj = 0; dj < 2; dj++) {
+      long long j = j0 + dj;
+      dvec3 grad = table_gradient(corners.cell_seed(ivec3(2 * i - j, 2 * j, 0)), false);
+      cached[(size_t)(i - imin) * 2 + dj] =
+          row_corner(dvec3((double)i - 0.5 * (double)j, (double)j, 0), grad, yl, 0);
+    }
+
+  for (size_t x = 0; x < width; x++) {
+    double xl = (double)x / cs;
+    double u = xl + 0.5 * yl;
+    long long i0 = floor_cell(u);
+    double fu = u - i0;
+
+    // the triangle goes through (0, 0), (1, 1) and (1, 0) below the diagonal or (0, 1) above it
+    simplex_corner const* c = &cached[(size_t)(i0 - imin) * 2];
+    size_t middle = fu >= fv ? 2 : 1;
+
+    double n = corner_noise(c[0], 0.8, xl);
+    n += corner_noise(c[middle], 0.8, xl);
+    n += corner_noise(c[3], 0.8, xl);
+
+    values[x] = 10.9 * n;
+  }
+}
+
+// the lattice is skewed by (u, v, w) = (y + z, x + z, x + y), corner (cu, cv, cw) is at
+// (-cu + cv + cw, cu - cv + cw, cu + cv - cw) / 2 in cells
+void simplex_octave::row3(double y, double z, double values[]) const {
+  double cs = ltc.get_cellsize();
+
+  double yl = y / cs;
+  double zl = z / cs;
+  double u = yl + zl;
+  long long u0 = floor_cell(u);
+  double fu = u - u0;
+
+  // skewed cell of every pixel, u is the same along the row
+  std::vector<long long> vcells(width), wcells(width);
+  long long dmin = std::numeric_limits<long long>::max();
+  long long dmax = std::numeric_limits<long long>::min();
+  for (size_t x = 0; x < width; x++) {
+    double xl = (double)x / cs;
+    vcells[x] = floor_cell(xl + zl);
+    wcells[x] = floor_cell(xl + yl);
+    dmin = std::min(dmin, wcells[x] - vcells[x]);
+    dmax = std::max(dmax, wcells[x] - vcells[x]);
+  }
+
+  // every corner that the row touches. Since v and w grow at the same rate, cw - cv only takes a
+  // few values, so they're stored as
+  //   [((cv - vmin) * 2 + (cu - u0)) * diagonals + (cw - cv - dmin)]
+  // where the corners add -1 to 1 to the pixels' cw - cv
+  long long vmin = vcells.front();
+  long long vmax = vcells.back() + 1;
+  dmin -= 1;
+  dmax += 1;
+  size_t diagonals = (size_t)(dmax + 1 - dmin);
+  std::vector<simplex_corner> cached((size_t)(vmax + 1 - vmin) * 2 * diagonals);
+  for (long long cv = vmin; cv <= vmax; cv++)
+    for (long long du = 0; du < 2; du++)
+      for (long long cw = cv + dmin; cw <= cv + dmax; cw++) {
+        long long cu = u0 + du;
+        ivec3 half(-cu + cv + cw, cu - cv + cw, cu + cv - cw);
+        dvec3 grad = table_gradient(corners.cell_seed(half), true);
+        cached[((size_t)(cv - vmin) * 2 + du) * diagonals + (size_t)(cw - cv - dmin)] =
+            row_corner(dvec3(0.5 * half.x, 0.5 * half.y, 0.5 * half.z), grad, yl, zl);
+      }
+
+  // the tetrahedron steps along the axis with the largest fraction first, then the second
+  // largest, so its middle corners are picked by the order of the fractions, indexed by
+  // (fu >= fv) * 4 + (fv >= fw) * 2 + (fu >= fw). Orders 1 and 6 can't happen
+  static constexpr int ORDERS[8][2][3] = {
+    {{0, 0, 1}, {0, 1, 1}}, {{0, 0, 1}, {0, 1, 1}}, {{0, 1, 0}, {0, 1, 1}},
+    {{0, 1, 0}, {1, 1, 0}}, {{0, 0, 1}, {1, 0, 1}}, {{1, 0, 0}, {1, 0, 1}},
+    {{1, 0, 0}, {1, 1, 0}}, {{1, 0, 0}, {1, 1, 0}},
+  };
+
+  // a step along u, v or w moves this far in cached
+  size_t strides[3] = {diagonals, 2 * diagonals - 1, 1};
+  size_t middle[8][2];
+  for (size_t i = 0; i < 8; i++)
+    for (size_t k = 0; k < 2; k++)
+      middle[i][k] = ORDERS[i][k][0] * strides[0] + ORDERS[i][k][1] * strides[1] +
+                     ORDERS[i][k][2] * strides[2];
+  size_t last = strides[0] + strides[1] + strides[2];
+
+  for (size_t x = 0; x < width; x++) {
+    double xl = (double)x / cs;
+    long long v0 = vcells[x];
+    long long w0 = wcells[x];
+    double fv = xl + zl - v0;
+    double fw = xl + yl - w0;
+
+    simplex_corner const* c =
+        &cached[(size_t)(v0 - vmin) * 2 * diagonals + (size_t)(w0 - v0 - dmin)];
+    size_t const* m = middle[(fu >= fv) * 4 + (fv >= fw) * 2 + (fu >= fw)];
+
+    double n = corner_noise(c[0], 0.5, xl);
+    n += corner_noise(c[m[0]], 0.5, xl);
+    n += corner_noise(c[m[1]], 0.5, xl);
+    n += corner_noise(c[last], 0.5, xl);
+
+    values[x] = SIMPLEX3_SCALE * n;
+  }
+}
@@ -0,0 +1,326 @@
+#include "fractal.h"
+
+#include "larray.h"
+#include "lattice3.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+DECLARE_LUA_CLASS_NAMED(Fractal, Fractal);
+
+const char* FRACTAL_TYPE_NAMES[] = {
+  "fBm",
+  "Ridged",
+  "Turbulence",
+};
+
+template <typename Octave> std::vector<Octave> fractal_engine::make_octaves() const {
+  std::vector<Octave> octs;
+  octs.reserve(octaves);
+
+  bool threed = dimensions == 3;
+  double scale = 1;
+  for (int i = 0; i < octaves; i++) {
+    lattice3 ltc(cellsize / scale, freq * scale);
+    // octaves are seeded apart so their corners don't line up
+    ltc.set_seed((unsigned int)seed + (unsigned int)i);
+
+    if constexpr (std::is_same_v<Octave, worley_octave>)
+      octs.emplace_back(ltc, (size_t)width, (size_t)height, mean_points);
+    else
+      octs.emplace_back(ltc, (size_t)width, threed);
+
+    scale *= lacunarity;
+  }
+
+  return octs;
+}
+
+std::vector<double> fractal_engine::get_amplitudes() const {
+  std::vector<double> amplitudes(octaves);
+
+  double amplitude = 1;
+  for (double& a : amplitudes) {
+    a = amplitude;
+    amplitude *= gain;
+  }
+
+  return amplitudes;
+}
+
+template <typename Octave>
+void fractal_engine::compute_row(std::vector<Octave> const& octs,
+                                 std::vector<double> const& amplitudes, double y, double z,
+                                 double values[]) const {
+  size_t w = (size_t)width;
+  std::fill(values, values + w, 0.0);
+
+  std::vector<double> noise(w);
+  double total = 0;
+  for (size_t i = 0; i < octs.size(); i++) {
+    octs[i].row(y, z, noise.data());
+
+    double a = amplitudes[i];
+    switch (fractal) {
+    case FRACTAL_RIDGED:
+      for (size_t x = 0; x < w; x++) {
+        double r = 1 - std::fabs(noise[x]);
+        values[x] += a * r * r;
+      }
+      break;
+    case FRACTAL_TURBULENCE:
+      for (size_t x = 0; x < w; x++)
+        values[x] += a * std::fabs(noise[x]);
+      break;
+    default:
+      for (size_t x = 0; x < w; x++)
+        values[x] += a * noise[x];
+    }
+
+    total += std::fabs(a);
+  }
+
+  if (total > 0)
+    for (size_t x = 0; x < w; x++)
+      values[x] /= total;
+}
+
+std::string Fractal::to_string() const {
+  fractal_engine const& F = engine;
+  std::stringstream str;
+
+  str << "Fractal { ";
+
+  str << "seed: " << F.seed << ", ";
+  str << "width: " << F.width << ", ";
+  str << "height: " << F.height << ", ";
+  str << "length: " << F.length << ", ";
+  str << "cellsize: " << F.cellsize << ", ";
+  str << "octaves: " << F.octaves << ", ";
+  str << "lacunarity: " << F.lacunarity << ", ";
+  str << "gain: " << F.gain << ", ";
+  str << "fractal: " << FRACTAL_TYPE_NAMES[F.fractal] << ", ";
+  str << "base: " << BASE_NOISE_NAMES[F.base] << ", ";
+  str << "dimensions: " << F.dimensions << ", ";
+  str << "movement: " << F.movement << ", ";
+  str << "mean_points: " << F.mean_points << ", ";
+  str << "freq: " << F.freq;
+
+  str << " }";
+
+  return str.str();
+}
+
+#define GET_NUMBER(idx, field, key)                                            \
+  if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                \
+    F.field = luaL_checknumber(L, -1);                                         \
+  }                                                                            \
+  lua_pop(L, 1);
+#define GET_INTEGER(idx, field, key)                                           \
+  if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                \
+    F.field = luaL_checkinteger(L, -1);                                        \
+  }                                                                            \
+  lua_pop(L, 1);
+#define GET_ENUM(idx, ENUM, enum_last, field, key)                             \
+  if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                \
+    int val = luaL_checkinteger(L, -1);                                        \
+    if (val < 0 || val >= enum_last)                                           \
+      luaL_error(L, "invalid enum value passed as field");                     \
+    F.field = (ENUM)val;                                                       \
+  }                                                                            \
+  lua_pop(L, 1);
+void fractal_engine::load_options(lua_State* L, int idx, const char* name) {
+  fractal_engine& F = *this;
+
+  GET_NUMBER(idx, width, width);
+  GET_NUMBER(idx, height, height);
+  GET_INTEGER(idx, length, length);
+
+  GET_NUMBER(idx, cellsize, cellsize);
+  GET_INTEGER(idx, octaves, octaves);
+  GET_INTEGER(idx, dimensions, dimensions);
+  GET_NUMBER(idx, movement, movement);
+
+  GET_INTEGER(idx, seed, seed);
+  GET_ENUM(idx, ARRAY_TYPE, ARRAY_TYPE_LAST, array_type, array_type);
+
+  // get "loops" of form { x, y, z }
+  if (lua_getfield(L, idx, "loops") != LUA_TNIL) {
+    luaL_argexpected(L, lua_istable(L, -1), idx, "expected table of form {x,y,z}");
+
+    GET_NUMBER(-1, freq.x, x);
+    GET_NUMBER(-1, freq.y, y);
+    GET_NUMBER(-1, freq.z, z);
+  }
+  lua_pop(L, 1);
+
+  if (F.dimensions != 2 && F.dimensions != 3)
+    luaL_error(L, "%s dimensions must be 2 or 3", name);
+  if (F.octaves < 1)
+    luaL_error(L, "%s needs at least one octave", name);
+  if (!(F.cellsize > 0))
+    luaL_error(L, "%s cellsize must be positive", name);
+}
+
+void Fractal::load_options(lua_State* L, int idx) {
+  fractal_engine& F = engine;
+
+  F.load_options(L, idx, "Fractal");
+
+  GET_NUMBER(idx, lacunarity, lacunarity);
+  GET_NUMBER(idx, gain, gain);
+  GET_ENUM(idx, FRACTAL_TYPE, FRACTAL_TYPE_LAST, fractal, fractal);
+  GET_ENUM(idx, BASE_NOISE, BASE_NOISE_LAST, base, base);
+  GET_NUMBER(idx, mean_points, mean_points);
+
+  if (!(F.lacunarity > 0))
+    luaL_error(L, "Fractal lacunarity must be positive");
+}
+
+int Fractal::lnew(lua_State* L) {
+  Fractal F; // start off default initialized, fill in as we go
+  F.engine.seed = std::random_device()(); // default init seed in case none is given
+
+  int idx = 1;
+
+  if (lua_istable(L, idx)) {
+    F.load_options(L, idx);
+  } else if (lua_gettop(L) > 0) {
+    luaL_error(L, "invalid argument passed to Fractal constructor");
+  }
+
+  push_new<Fractal>(L, std::move(F));
+
+  // return Fractal userdata object
+  return 1;
+}
+
+int Fractal::set(lua_State* L) {
+  Fractal* fractal = get_obj<Fractal>(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  fractal->load_options(L, 2);
+
+  // return F, so that calls can be chained, e.g., F:set{ gain = 0.6 }:compute()
+  lua_pushvalue(L, 1);
+  return 1;
+}
+#undef GET_ENUM
+#undef GET_INTEGER
+#undef GET_NUMBER
+
+template <typename Octave> int fractal_engine::compute_frames(lua_State* L, int into) const {
+  size_t w = (size_t)width;
+  size_t h = (size_t)height;
+  size_t frames = (size_t)std::max(length, 0);
+  size_t size = w * h;
+
+  return visit_array_type(array_type, [&](auto tag) {
+    typedef typename decltype(tag)::type T;
+
+    // every larray is made (or reused) up front, since Lua can't be touched from the workers
+    std::vector<T*> outs(frames);
+    for (size_t frame = 0; frame < frames; frame++) {
+      lua_geti(L, into, frame + 1);
+      outs[frame] = larray<T>::push_or_reuse(L, -1, size)->values;
+
+      // frames[frame+1] = arr
+      lua_seti(L, into, frame + 1);
+      lua_pop(L, 1);
+    }
+
+    // octaves (and their caches) are kept for the whole animation
+    std::vector<Octave> octs = make_octaves<Octave>();
+    std::vector<double> amplitudes = get_amplitudes();
+
+    // z moves linearly over the length, and is given in cells of the first octave
+    double zjump = frames > 0 ? movement / (double)frames : 0.0;
+    auto frame_z = [&](size_t frame) { return dimensions == 3 ? frame * zjump * cellsize : 0.0; };
+
+    auto compute_into = [&](size_t frame, size_t y, double z) {
+      std::vector<double> row(w);
+      compute_row(octs, amplitudes, (double)y, z, row.data());
+
+      T* out = outs[frame] + y * w;
+      for (size_t x = 0; x < w; x++)
+        out[x] = larray_cast<T>(row[x]);
+    };
+
+    if constexpr (Octave::framewise) {
+      // the octaves are prepared for one frame at a time, so only its rows are split over the pool
+      for (size_t frame = 0; frame < frames; frame++) {
+        double z = frame_z(frame);
+        for (Octave& octave : octs)
+          octave.prepare(z);
+
+        thread_pool::shared().parallel_for(0, h, [&](size_t y) { compute_into(frame, y, z); });
+      }
+    } else {
+      // every row of every frame is independent, so they're all split over the pool at once
+      thread_pool::shared().parallel_for(0, frames * h, [&](size_t i) {
+        size_t frame = i / h;
+        compute_into(frame, i % h, frame_z(frame));
+      });
+    }
+
+    lua_pushvalue(L, into);
+
+    // return larray[]
+    return 1;
+  });
+}
+
+int fractal_engine::compute_frames(lua_State* L, int into) const {
+  switch (base) {
+  case BASE_VALUE:
+    return compute_frames<value_octave>(L, into);
+  case BASE_WORLEY:
+    return compute_frames<worley_octave>(L, into);
+  case BASE_SIMPLEX:
+    return compute_frames<simplex_octave>(L, into);
+  default:
+    return compute_frames<gradient_octave>(L, into);
+  }
+}
+
+int Fractal::compute(lua_State* L) {
+  Fractal* fractal = get_obj<Fractal>(L, 1);
+
+  lua_createtable(L, fractal->engine.length, 0);
+
+  return fractal->engine.compute_frames(L, lua_gettop(L));
+}
+
+int Fractal::compute_into(lua_State* L) {
+  Fractal* fractal = get_obj<Fractal>(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  return fractal->engine.compute_frames(L, 2);
+}
+
+int Fractal::to_string(lua_State* L) {
+  Fractal* fractal = get_obj<Fractal>(L, 1);
+
+  // this is fine since Lua copies all pushed strings anyway
+  lua_pushstring(L, fractal->to_string().c_str());
+
+  return 1;
+}
+
+void Fractal::register_class(lua_State* L) {
+  static const luaL_Reg methods[] = {{"compute", Fractal::compute},
+                                     {"compute_into", Fractal::compute_into},
+                                     {"set", Fractal::set},
+                                     {"__tostring", Fractal::to_string},
+                                     {nullptr, nullptr}};
+
+  REG_LUA_CLASS(L, Fractal, methods);
+  REG_LUA_CNSTR(L, Fractal, Fractal::lnew);
+}
@@ -0,0 +1,360 @@
+#include "gradient_noise.h"
+
+#include "gradient_noise_simd.h"
+#include "larray.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if GRADIENT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if GRADIENT_AVX2 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+const char* GRADIENT_KERNEL_NAMES[] = {
+  "Scalar",
+  "SSE2",
+  "AVX2",
+};
+
+// scalar reference, written out plainly. The SIMD kernels in gradient_noise_simd.h do the exact
+// same steps, which is what GradientNoiseTests checks them against
+
+static inline uint32_t hash(uint32_t seed, uint32_t px, uint32_t py, uint32_t pz) {
+  uint32_t h = seed ^ px ^ py ^ pz;
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  return h ^ (h >> 16);
+}
+
+static inline float grad2(uint32_t h, float x, float y) {
+  float u = h & 4 ? y : x;
+  float v = h & 4 ? x : y;
+  return (h & 1 ? -u : u) + 0.5f * (h & 2 ? -v : v);
+}
+
+static inline float grad3(uint32_t h, float x, float y, float z) {
+  uint32_t k = h & 15;
+  float u = k < 8 ? x : y;
+  float v = k < 4 ? y : (k == 12 || k == 14 ? x : z);
+  return (h & 1 ? -u : u) + (h & 2 ? -v : v);
+}
+
+static inline float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+
+static inline float lerp(float a, float b, float t) { return t * (b - a) + a; }
+
+static float noise2_scalar(uint32_t seed, float x, float y) {
+  using namespace gradient_simd;
+
+  float xf = std::floor(x), yf = std::floor(y);
+  float fx = x - xf, fy = y - yf;
+
+  uint32_t px = (uint32_t)(int32_t)xf * PRIME_X;
+  uint32_t py = (uint32_t)(int32_t)yf * PRIME_Y;
+
+  float n00 = grad2(hash(seed, px, py, 0), fx, fy);
+  float n10 = grad2(hash(seed, px + PRIME_X, py, 0), fx - 1, fy);
+  float n01 = grad2(hash(seed, px, py + PRIME_Y, 0), fx, fy - 1);
+  float n11 = grad2(hash(seed, px + PRIME_X, py + PRIME_Y, 0), fx - 1, fy - 1);
+
+  float u = fade(fx), v = fade(fy);
+  return lerp(lerp(n00, n10, u), lerp(n01, n11, u), v);
+}
+
+static float noise3_scalar(uint32_t seed, float x, float y, float z) {
+  using namespace gradient_simd;
+
+  float xf = std::floor(x), yf = std::floor(y), zf = std::floor(z);
+  float fx = x - xf, fy = y - yf, fz = z - zf;
+
+  uint32_t px = (uint32_t)(int32_t)xf * PRIME_X;
+  uint32_t py = (uint32_t)(int32_t)yf * PRIME_Y;
+  uint32_t pz = (uint32_t)(int32_t)zf * PRIME_Z;
+
+  // corner (dx, dy, dz)
+  auto corner = [&](uint32_t dx, uint32_t dy, uint32_t dz) {
+    uint32_t h = hash(seed, px + dx * PRIME_X, py + dy * PRIME_Y, pz + dz * PRIME_Z);
+    return grad3(h, fx - dx, fy - dy, fz - dz);
+  };
+
+  float u = fade(fx), v = fade(fy), w = fade(fz);
+
+  // x first, then y, then z
+  float n0 = lerp(lerp(corner(0, 0, 0), corner(1, 0, 0), u),
+                  lerp(corner(0, 1, 0), corner(1, 1, 0), u), v);
+  float n1 = lerp(lerp(corner(0, 0, 1), corner(1, 0, 1), u),
+                  lerp(corner(0, 1, 1), corner(1, 1, 1), u), v);
+  return lerp(n0, n1, w);
+}
+
+#if GRADIENT_SSE2
+namespace {
+
+// 4 lanes, SSE2 has neither floor, 32-bit multiplies, blends nor FMA so those are built up
+struct sse2_ops {
+  static constexpr size_t width = 4;
+  typedef __m128 f;
+  typedef __m128i i;
+
+  static inline f load(float const* p) { return _mm_loadu_ps(p); }
+  static inline void store(float* p, f v) { _mm_storeu_ps(p, v); }
+  static inline f set1(float v) { return _mm_set1_ps(v); }
+  static inline i set1i(uint32_t v) { return _mm_set1_epi32((int)v); }
+
+  static inline f add(f a, f b) { return _mm_add_ps(a, b); }
+  static inline f sub(f a, f b) { return _mm_sub_ps(a, b); }
+  static inline f mul(f a, f b) { return _mm_mul_ps(a, b); }
+  static inline f madd(f a, f b, f c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+  // truncates, then steps down where that rounded up, i.e., for negative non integers
+  static inline f floor(f v) {
+    f t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+  }
+  static inline i to_int(f v) { return _mm_cvttps_epi32(v); }
+
+  static inline i addi(i a, i b) { return _mm_add_epi32(a, b); }
+  static inline i andi(i a, i b) { return _mm_and_si128(a, b); }
+  static inline i xori(i a, i b) { return _mm_xor_si128(a, b); }
+
+  // low 32 bits of every product, from the 64-bit products of the even and odd lanes
+  static inline i mullo(i a, i b) {
+    i even = _mm_mul_epu32(a, b);
+    i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+  }
+
+  template <int N> static inline i srli(i v) { return _mm_srli_epi32(v, N); }
+  template <int N> static inline i slli(i v) { return _mm_slli_epi32(v, N); }
+
+  static inline i is_zero(i v) { return _mm_cmpeq_epi32(v, _mm_setzero_si128()); }
+  static inline i equals(i a, i b) { return _mm_cmpeq_epi32(a, b); }
+
+  static inline f select(i mask, f a, f b) {
+    f m = _mm_castsi128_ps(mask);
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static inline f flip_sign(f v, i bits) { return _mm_xor_ps(v, _mm_castsi128_ps(bits)); }
+};
+
+} // namespace
+#endif
+
+static bool cpu_has_avx2() {
+#if GRADIENT_AVX2 && (defined(__GNUC__) || defined(__clang__))
+  // also checks that the OS saves the AVX registers
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif GRADIENT_AVX2 && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+
+  // FMA, OSXSAVE and AVX, then whether the OS saves the xmm/ymm registers
+  __cpuid(info, 1);
+  const int needed = (1 << 12) | (1 << 27) | (1 << 28);
+  if ((info[2] & needed) != needed || (_xgetbv(0) & 6) != 6)
+    return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+bool gradient_kernel_supported(GRADIENT_KERNEL kernel) {
+  switch (kernel) {
+  case KERNEL_SCALAR:
+    return true;
+  case KERNEL_SSE2:
+    return GRADIENT_SSE2;
+  case KERNEL_AVX2: {
+    static const bool avx2 = cpu_has_avx2();
+    return avx2;
+  }
+  default:
+    return false;
+  }
+}
+
+GRADIENT_KERNEL best_gradient_kernel() {
+  static const GRADIENT_KERNEL best = gradient_kernel_supported(KERNEL_AVX2)   ? KERNEL_AVX2
+                                      : gradient_kernel_supported(KERNEL_SSE2) ? KERNEL_SSE2
+                                                                               : KERNEL_SCALAR;
+  return best;
+}
+
+static void check_kernel(GRADIENT_KERNEL kernel) {
+  if (!gradient_kernel_supported(kernel))
+    throw std::invalid_argument{std::string("gradient noise kernel is not supported here: ") +
+                                (kernel < GRADIENT_KERNEL_LAST ? GRADIENT_KERNEL_NAMES[kernel]
+                                                               : "unknown")};
+}
+
+void gradient_noise2(GRADIENT_KERNEL kernel, uint32_t seed, float const x[], float const y[],
+                     float out[], size_t n) {
+  check_kernel(kernel);
+
+  switch (kernel) {
+#if GRADIENT_AVX2
+  case KERNEL_AVX2:
+    gradient_simd::noise2_avx2(seed, x, y, out, n);
+    return;
+#endif
+#if GRADIENT_SSE2
+  case KERNEL_SSE2:
+    gradient_simd::noise2_n<sse2_ops>(seed, x, y, out, n);
+    return;
+#endif
+  default:
+    for (size_t i = 0; i < n; i++)
+      out[i] = noise2_scalar(seed, x[i], y[i]);
+  }
+}
+
+void gradient_noise3(GRADIENT_KERNEL kernel, uint32_t seed, float const x[], float const y[],
+                     float const z[], float out[], size_t n) {
+  check_kernel(kernel);
+
+  switch (kernel) {
+#if GRADIENT_AVX2
+  case KERNEL_AVX2:
+    gradient_simd::noise3_avx2(seed, x, y, z, out, n);
+    return;
+#endif
+#if GRADIENT_SSE2
+  case KERNEL_SSE2:
+    gradient_simd::noise3_n<sse2_ops>(seed, x, y, z, out, n);
+    return;
+#endif
+  default:
+    for (size_t i = 0; i < n; i++)
+      out[i] = noise3_scalar(seed, x[i], y[i], z[i]);
+  }
+}
+
+// fixed, so that the same seed gives the same noise across runs
+static constexpr unsigned int GRADIENT_TABLE_SEED = 0x5EED6AD;
+
+// same distributions as gen_grad/gen_grad3d in perlin.lua, a random angle in 2D and a normalized
+// vector of sines of random angles in 3D
+static std::vector<double> make_gradient_table(size_t dimensions) {
+  const double pi2 = 6.283185307179586;
+
+  std::mt19937 gen(GRADIENT_TABLE_SEED);
+  std::uniform_real_distribution<double> angle(0.0, pi2);
+
+  std::vector<double> table(GRADIENT_TABLE_SIZE * dimensions);
+  for (size_t i = 0; i < table.size(); i += dimensions) {
+    if (dimensions == 2) {
+      double r = angle(gen);
+      table[i] = std::cos(r);
+      table[i + 1] = std::sin(r);
+      continue;
+    }
+
+    double x = std::sin(angle(gen));
+    double y = std::sin(angle(gen));
+    double z = std::sin(angle(gen));
+    double mag = std::sqrt(x * x + y * y + z * z);
+    table[i] = x / mag;
+    table[i + 1] = y / mag;
+    table[i + 2] = z / mag;
+  }
+
+  return table;
+}
+
+std::vector<double> const& gradient_table(size_t dimensions) {
+  if (dimensions == 2) {
+    static const std::vector<double> table2 = make_gradient_table(2);
+    return table2;
+  }
+  if (dimensions == 3) {
+    static const std::vector<double> table3 = make_gradient_table(3);
+    return table3;
+  }
+
+  throw std::invalid_argument{"gradient tables are only 2D or 3D, not " +
+                              std::to_string(dimensions) + "D"};
+}
+
+int l_gradient_table(lua_State* L) {
+  lua_Integer dimensions = luaL_optinteger(L, 1, 2);
+  luaL_argcheck(L, dimensions == 2 || dimensions == 3, 1, "dimensions must be 2 or 3");
+
+  std::vector<double> const& table = gradient_table((size_t)dimensions);
+
+  larray<double>* arr = larray<double>::push(L, table.size());
+  std::copy(table.begin(), table.end(), arr->values);
+
+  return 1;
+}
+
+int l_gradient_noise(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+
+  lua_Integer seed = 0;
+  lua_Integer width = 0;
+  lua_Integer height = 0;
+  double cellsize = 1;
+  double z = 0;
+  lua_Integer dimensions = 2;
+  lua_Integer kernel = best_gradient_kernel();
+
+  try_get_num_field(L, seed, 1, -1, "seed");
+  try_get_num_field(L, width, 1, -1, "width");
+  try_get_num_field(L, height, 1, -1, "height");
+  try_get_num_field(L, cellsize, 1, -1, "cellsize");
+  try_get_num_field(L, z, 1, -1, "z");
+  try_get_num_field(L, dimensions, 1, -1, "dimensions");
+  try_get_num_field(L, kernel, 1, -1, "kernel");
+
+  if (width < 0 || height < 0)
+    luaL_error(L, "gradient_noise width and height can't be negative");
+  if (!(cellsize > 0))
+    luaL_error(L, "gradient_noise cellsize must be positive");
+  if (dimensions != 2 && dimensions != 3)
+    luaL_error(L, "gradient_noise dimensions must be 2 or 3");
+  if (kernel < 0 || kernel >= GRADIENT_KERNEL_LAST ||
+      !gradient_kernel_supported((GRADIENT_KERNEL)kernel))
+    luaL_error(L, "gradient_noise kernel is not supported on this CPU");
+
+  size_t w = (size_t)width, h = (size_t)height;
+  larray<float>* arr = larray<float>::push(L, w * h);
+
+  // positions along x are the same on every row, and y/z the same across a row
+  std::vector<float> xs(w);
+  for (size_t x = 0; x < w; x++)
+    xs[x] = (float)(x / cellsize);
+
+  thread_pool::shared().parallel_for(0, h, [&](size_t y) {
+    std::vector<float> ys(w, (float)(y / cellsize));
+    float* out = arr->values + y * w;
+
+    if (dimensions == 3) {
+      std::vector<float> zs(w, (float)z);
+      gradient_noise3((GRADIENT_KERNEL)kernel, (uint32_t)seed, xs.data(), ys.data(), zs.data(),
+                      out, w);
+    } else {
+      gradient_noise2((GRADIENT_KERNEL)kernel, (uint32_t)seed, xs.data(), ys.data(), out, w);
+    }
+  });
+
+  return 1;
+}
@@ -0,0 +1,73 @@
+// AVX2 gradient noise kernel. This is the only translation unit built with AVX2 and FMA enabled
+// (see src/CMakeLists.txt), so nothing in here may be called before gradient_kernel_supported has
+// checked the CPU for them. Keep it to the kernel alone, any inline function shared with the rest
+// of the library could end up compiled with AVX2 instructions.
+
+#include "gradient_noise.h"
+
+#if GRADIENT_AVX2
+
+#if !defined(__AVX2__) || !defined(__FMA__)
+#if !defined(_MSC_VER) // /arch:AVX2 doesn't define __FMA__, but does enable it
+#error "gradient_noise_avx2.cc has to be built with AVX2 and FMA enabled, see src/CMakeLists.txt"
+#endif
+#endif
+
+#include "gradient_noise_simd.h"
+
+#include <immintrin.h>
+
+namespace {
+
+// 8 lanes with native floor, 32-bit multiplies, blends and FMA
+struct avx2_ops {
+  static constexpr size_t width = 8;
+  typedef __m256 f;
+  typedef __m256i i;
+
+  static inline f load(float const* p) { return _mm256_loadu_ps(p); }
+  static inline void store(float* p, f v) { _mm256_storeu_ps(p, v); }
+  static inline f set1(float v) { return _mm256_set1_ps(v); }
+  static inline i set1i(uint32_t v) { return _mm256_set1_epi32((int)v); }
+
+  static inline f add(f a, f b) { return _mm256_add_ps(a, b); }
+  static inline f sub(f a, f b) { return _mm256_sub_ps(a, b); }
+  static inline f mul(f a, f b) { return _mm256_mul_ps(a, b); }
+  static inline f madd(f a, f b, f c) { return _mm256_fmadd_ps(a, b, c); }
+
+  static inline f floor(f v) { return _mm256_floor_ps(v); }
+  static inline i to_int(f v) { return _mm256_cvttps_epi32(v); }
+
+  static inline i addi(i a, i b) { return _mm256_add_epi32(a, b); }
+  static inline i andi(i a, i b) { return _mm256_and_si256(a, b); }
+  static inline i xori(i a, i b) { return _mm256_xor_si256(a, b); }
+  static inline i mullo(i a, i b) { return _mm256_mullo_epi32(a, b); }
+
+  template <int N> static inline i srli(i v) { return _mm256_srli_epi32(v, N); }
+  template <int N> static inline i slli(i v) { return _mm256_slli_epi32(v, N); }
+
+  static inline i is_zero(i v) { return _mm256_cmpeq_epi32(v, _mm256_setzero_si256()); }
+  static inline i equals(i a, i b) { return _mm256_cmpeq_epi32(a, b); }
+
+  static inline f select(i mask, f a, f b) {
+    return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask));
+  }
+  static inline f flip_sign(f v, i bits) { return _mm256_xor_ps(v, _mm256_castsi256_ps(bits)); }
+};
+
+} // namespace
+
+namespace gradient_simd {
+
+void noise2_avx2(uint32_t seed, float const x[], float const y[], float out[], size_t n) {
+  noise2_n<avx2_ops>(seed, x, y, out, n);
+}
+
+void noise3_avx2(uint32_t seed, float const x[], float const y[], float const z[], float out[],
+                 size_t n) {
+  noise3_n<avx2_ops>(seed, x, y, z, out, n);
+}
+
+} // namespace gradient_simd
+
+#endif
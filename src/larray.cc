@@ -1,33 +1,66 @@
 #include "larray.h"
 
 DECLARE_LUA_CLASS_NAMED(larray<double>, ldarray)
+DECLARE_LUA_CLASS_NAMED(larray<float>, lfarray)
+DECLARE_LUA_CLASS_NAMED(larray<uint8_t>, lbarray)
+DECLARE_LUA_CLASS_NAMED(larray<uint16_t>, lwarray)
+DECLARE_LUA_CLASS_NAMED(larray<uint32_t>, luarray)
 
-template<>
-int larray<double>::set(lua_State* L) {
-    larray<double>* arr = get_obj<larray<double>>(L, 1);
-    int idx = (int)luaL_checkinteger(L, 2) - 1;
-    
-    luaL_argcheck(L, arr != nullptr, 1, "'larray<double>' expected");
-    luaL_argcheck(L, 0 <= idx && idx < arr->size, 2, "index out of range");
-    luaL_checkany(L, 3);
-
-    // the reason this function is specialized is exactly because of this, can't really generalize
-    // this part ...
-    double val = luaL_checknumber(L, 3);
-    arr->values[idx] = val;
-
-    return 0;
-}
+const char* ARRAY_TYPE_NAMES[] = {
+  "Double",
+  "Float",
+  "U8",
+  "U16",
+  "U32",
+};
+
+const char* BYTE_FORMAT_NAMES[] = {
+  "rgba",
+  "grayscale",
+  "indexed",
+  nullptr,
+};
+
+const size_t BYTE_FORMAT_CHANNELS[] = {4, 2, 1};
+
+int larray_from_bytes(lua_State* L) {
+  size_t length;
+  auto bytes = (const unsigned char*)luaL_checklstring(L, 1, &length);
+  lua_Integer type = luaL_optinteger(L, 2, ARRAY_U8);
+  double scale = luaL_optnumber(L, 3, 1.0);
+
+  luaL_argcheck(L, 0 <= type && type < ARRAY_TYPE_LAST, 2, "invalid array type");
 
-template<>
-int larray<double>::get(lua_State* L) {
-    larray<double>* arr = get_obj<larray<double>>(L, 1);
-    int idx = (int)luaL_checkinteger(L, 2) - 1;
+  visit_array_type((ARRAY_TYPE)type, [&](auto tag) {
+    typedef typename decltype(tag)::type T;
 
-    luaL_argcheck(L, arr != nullptr, 1, "'larray<double>' expected");
-    luaL_argcheck(L, 0 <= idx && idx < arr->size, 2, "index out of range");
+    larray<T>* arr = larray<T>::push(L, length);
 
-    lua_pushnumber(L, arr->values[idx]);
+    if (scale == 1.0)
+      for (size_t i = 0; i < length; i++)
+        arr->values[i] = bytes[i];
+    else
+      for (size_t i = 0; i < length; i++)
+        arr->values[i] = larray_cast<T>(bytes[i] * scale);
+  });
 
-    return 1;
-}
\ No newline at end of file
+  return 1;
+}
+
+void register_larray_classes(lua_State* L) {
+  larray<double>::register_class(L);
+  larray<float>::register_class(L);
+  larray<uint8_t>::register_class(L);
+  larray<uint16_t>::register_class(L);
+  larray<uint32_t>::register_class(L);
+
+  // larray.from_bytes, ...
+  static const luaL_Reg larray_functions[] = {
+    { "from_bytes", larray_from_bytes },
+    { nullptr, nullptr }
+  };
+
+  lua_newtable(L);
+  luaL_setfuncs(L, larray_functions, 0);
+  lua_setglobal(L, "larray");
+}
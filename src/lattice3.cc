@@ -4,13 +4,23 @@
 
 #include <time.h>
 #include <math.h>
+#include <algorithm>
 #include <cmath>
 #include <random>
 
+// a fractional freq has no exact period on the integer lattice, so it is rounded to the nearest
+// whole number of cells (but at least one)
+static long long cell_period(double freq) {
+    if (freq == 0)
+        return 0;
+    return std::max(1LL, std::llround(std::fabs(freq)));
+}
+
 lattice3::lattice3(double cs, dvec3 freq)
     : cs(cs), freq(freq), offset(0),
       seed(std::random_device()()),
-      scaled_freq(freq*cs)
+      scaled_freq(freq*cs),
+      period(cell_period(freq.x), cell_period(freq.y), cell_period(freq.z))
 {}
 
 void lattice3::set_seed(unsigned int new_seed) {
@@ -64,3 +74,71 @@ dvec3 lattice3::point_rep(const dvec3& v) const {
         freq.z == 0 ? v.z : pmod(v.z, scaled_freq.z)
     );
 }
+
+// splitmix64 finalizer, see https://xoshiro.di.unimi.it/splitmix64.c
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline long long pmod_cell(long long c, long long period) {
+    if (period == 0)
+        return c;
+    c %= period;
+    return c < 0 ? c + period : c;
+}
+
+long long lattice3::cell_of(double v) const {
+    return (long long)floor(v / cs);
+}
+
+ivec3 lattice3::cell_of(double x, double y, double z) const {
+    return ivec3(
+        cell_of(x + offset.x),
+        cell_of(y + offset.y),
+        cell_of(z + offset.z)
+    );
+}
+
+dvec3 lattice3::corner_of(const ivec3& cell) const {
+    return dvec3(cell.x * cs, cell.y * cs, cell.z * cs);
+}
+
+ivec3 lattice3::cell_rep(const ivec3& cell) const {
+    return ivec3(
+        pmod_cell(cell.x, period.x),
+        pmod_cell(cell.y, period.y),
+        pmod_cell(cell.z, period.z)
+    );
+}
+
+uint64_t lattice3::cell_seed(const ivec3& cell) const {
+    ivec3 rep = cell_rep(cell);
+
+    uint64_t h = mix64(seed + 0x9E3779B97F4A7C15ULL);
+    h = mix64(h ^ (uint64_t)rep.x);
+    h = mix64(h ^ (uint64_t)rep.y);
+    return mix64(h ^ (uint64_t)rep.z);
+}
+
+void lattice3::cells_along(double from, size_t count, long long out[]) const {
+    // the cell only changes every cs pixels, so only pixels within a step of the next boundary go
+    // through cell_of, which keeps the result exactly the same as calling it for every pixel
+    long long cell = cell_of(from);
+    double next = (cell + 1) * cs;
+    for (size_t i = 0; i < count; i++) {
+        double v = from + i;
+        if (v + 1 >= next) {
+            cell = cell_of(v);
+            next = (cell + 1) * cs;
+        }
+        out[i] = cell;
+    }
+}
+
+size_t lattice3::cell_hash::operator()(const ivec3& cell) const {
+    uint64_t h = mix64((uint64_t)cell.x);
+    h = mix64(h ^ (uint64_t)cell.y);
+    return mix64(h ^ (uint64_t)cell.z);
+}
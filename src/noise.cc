@@ -4,11 +4,15 @@
 #include <vector>
 
 #include "common.h"
+#include "fractal.h"
+#include "gradient_noise.h"
 #include "worley.h"
 #include "larray.h"
 #include "worley.h"
 #include "math_utils.h"
+#include "perlin.h"
 #include "smaa.h"
+#include "voronoi.h"
 
 static int l_print(lua_State* L) {
   std::cout << "Hello, World!" << std::endl;
@@ -96,6 +100,10 @@ static const struct luaL_Reg mylib[] = {
   {"print", l_print},
   {"sum", l_sum},
   {"SMAA", l_SMAA},
+  {"SMAA_batch", l_SMAA_batch},
+  {"gradient_noise", l_gradient_noise},
+  {"gradient_table", l_gradient_table},
+  {"voronoi", l_voronoi},
   {nullptr, nullptr}
 };
 
@@ -118,9 +126,61 @@ EXPORT int luaopen_libnoise(lua_State* L) {
   }
   lua_setfield(L, -2, "ERPFUNCS");
 
+  // libnoise.ARRAY_TYPES
+  lua_newtable(L);
+  for(size_t i = ARRAY_DOUBLE; i < ARRAY_TYPE_LAST; i++) {
+    lua_pushinteger(L, i);
+    lua_setfield(L, -2, ARRAY_TYPE_NAMES[i]);
+  }
+  lua_setfield(L, -2, "ARRAY_TYPES");
+
+  // libnoise.SMAA_EDGE_DETECTION
+  lua_newtable(L);
+  for(size_t i = COLOR_EDGES; i < EDGE_DETECTION_LAST; i++) {
+    lua_pushinteger(L, i);
+    lua_setfield(L, -2, EDGE_DETECTION_NAMES[i]);
+  }
+  lua_setfield(L, -2, "SMAA_EDGE_DETECTION");
+
+  // libnoise.SMAA_LOOKUP_PRECISION
+  lua_newtable(L);
+  for(size_t i = LOOKUP_U8; i < LOOKUP_PRECISION_LAST; i++) {
+    lua_pushinteger(L, i);
+    lua_setfield(L, -2, LOOKUP_PRECISION_NAMES[i]);
+  }
+  lua_setfield(L, -2, "SMAA_LOOKUP_PRECISION");
+
+  // libnoise.GRADIENT_KERNELS, only the ones this CPU supports
+  lua_newtable(L);
+  for(size_t i = KERNEL_SCALAR; i < GRADIENT_KERNEL_LAST; i++) {
+    if(!gradient_kernel_supported((GRADIENT_KERNEL)i))
+      continue;
+    lua_pushinteger(L, i);
+    lua_setfield(L, -2, GRADIENT_KERNEL_NAMES[i]);
+  }
+  lua_setfield(L, -2, "GRADIENT_KERNELS");
+
+  // libnoise.FRACTAL_TYPES
+  lua_newtable(L);
+  for(size_t i = FRACTAL_FBM; i < FRACTAL_TYPE_LAST; i++) {
+    lua_pushinteger(L, i);
+    lua_setfield(L, -2, FRACTAL_TYPE_NAMES[i]);
+  }
+  lua_setfield(L, -2, "FRACTAL_TYPES");
+
+  // libnoise.BASE_NOISES
+  lua_newtable(L);
+  for(size_t i = BASE_PERLIN; i < BASE_NOISE_LAST; i++) {
+    lua_pushinteger(L, i);
+    lua_setfield(L, -2, BASE_NOISE_NAMES[i]);
+  }
+  lua_setfield(L, -2, "BASE_NOISES");
+
   // push classes into the global namespace ...
-  larray<double>::register_class(L);
+  register_larray_classes(L);
   Worley::register_class(L);
+  Perlin::register_class(L);
+  Fractal::register_class(L);
 
   return 1;
 }
@@ -0,0 +1,95 @@
+#include "perlin.h"
+
+#include "utils.h"
+
+#include <random>
+#include <sstream>
+#include <string>
+
+DECLARE_LUA_CLASS_NAMED(Perlin, Perlin);
+
+std::string Perlin::to_string() const {
+  fractal_engine const& P = engine;
+  std::stringstream str;
+
+  str << "Perlin { ";
+
+  str << "seed: " << P.seed << ", ";
+  str << "width: " << P.width << ", ";
+  str << "height: " << P.height << ", ";
+  str << "length: " << P.length << ", ";
+  str << "cellsize: " << P.cellsize << ", ";
+  str << "octaves: " << P.octaves << ", ";
+  str << "dimensions: " << P.dimensions << ", ";
+  str << "movement: " << P.movement << ", ";
+  str << "freq: " << P.freq;
+
+  str << " }";
+
+  return str.str();
+}
+
+int Perlin::lnew(lua_State* L) {
+  Perlin P; // start off default initialized, fill in as we go
+  P.engine.seed = std::random_device()(); // default init seed in case none is given
+  P.engine.octaves = 1;
+
+  int idx = 1;
+
+  if (lua_istable(L, idx)) {
+    P.engine.load_options(L, idx, "Perlin");
+  } else if (lua_gettop(L) > 0) {
+    luaL_error(L, "invalid argument passed to Perlin constructor");
+  }
+
+  push_new<Perlin>(L, std::move(P));
+
+  // return Perlin userdata object
+  return 1;
+}
+
+int Perlin::set(lua_State* L) {
+  Perlin* perlin = get_obj<Perlin>(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  perlin->engine.load_options(L, 2, "Perlin");
+
+  // return P, so that calls can be chained, e.g., P:set{ seed = 2 }:compute()
+  lua_pushvalue(L, 1);
+  return 1;
+}
+
+int Perlin::compute(lua_State* L) {
+  Perlin* perlin = get_obj<Perlin>(L, 1);
+
+  lua_createtable(L, perlin->engine.length, 0);
+
+  return perlin->engine.compute_frames(L, lua_gettop(L));
+}
+
+int Perlin::compute_into(lua_State* L) {
+  Perlin* perlin = get_obj<Perlin>(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  return perlin->engine.compute_frames(L, 2);
+}
+
+int Perlin::to_string(lua_State* L) {
+  Perlin* perlin = get_obj<Perlin>(L, 1);
+
+  // this is fine since Lua copies all pushed strings anyway
+  lua_pushstring(L, perlin->to_string().c_str());
+
+  return 1;
+}
+
+void Perlin::register_class(lua_State* L) {
+  static const luaL_Reg methods[] = {{"compute", Perlin::compute},
+                                     {"compute_into", Perlin::compute_into},
+                                     {"set", Perlin::set},
+                                     {"__tostring", Perlin::to_string},
+                                     {nullptr, nullptr}};
+
+  REG_LUA_CLASS(L, Perlin, methods);
+  REG_LUA_CNSTR(L, Perlin, Perlin::lnew);
+}
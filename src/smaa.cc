@@ -1,10 +1,14 @@
 #include "smaa.h"
 #include "larray.h"
+#include "thread_pool.h"
 #include "utils.h"
 
 #include "SMAA/areatex.h"
 #include "SMAA/searchtex.h"
 
+#include <optional>
+#include <vector>
+
 /**
  * Note: seeing as this is pretty much just a port of the HLSL version of SMAA
  * to C++, the following notice from the original software is included:
@@ -257,6 +261,7 @@
 
 /* == PHASE 1 - Edge Detection ============================================= */
 
+template <typename W>
 static float2 SMAAColorEdgeDetectionPS(size_t x, size_t y, float4 offset[3], fbuffer4 const& tex) {
 #define vmax(v) std::max(std::max(v[0], v[1]), v[2])
   const float2 discard = float2{0.0f, 0.0f};
@@ -268,11 +273,11 @@ static float2 SMAAColorEdgeDetectionPS(size_t x, size_t y, float4 offset[3], fbu
 
   float3 C = tex.cget(x, y).get<0, 1, 2>();
 
-  float3 Cleft = tex.get_or_clamp(offset[0][0], offset[0][1]).get<0, 1, 2>();
+  float3 Cleft = tex.fetch<W>(offset[0][0], offset[0][1]).template get<0, 1, 2>();
   float3 t = float3::abs(C - Cleft);
   delta[0] = vmax(t);
 
-  float3 Ctop = tex.get_or_clamp(offset[0][2], offset[0][3]).get<0, 1, 2>();
+  float3 Ctop = tex.fetch<W>(offset[0][2], offset[0][3]).template get<0, 1, 2>();
   t = float3::abs(C - Ctop);
   delta[1] = vmax(t);
 
@@ -284,22 +289,22 @@ static float2 SMAAColorEdgeDetectionPS(size_t x, size_t y, float4 offset[3], fbu
   if (edges[0] + edges[1] == 0.0f)
     return discard;
 
-  float3 Cright = tex.get_or_clamp(offset[1][0], offset[1][1]).get<0, 1, 2>();
+  float3 Cright = tex.fetch<W>(offset[1][0], offset[1][1]).template get<0, 1, 2>();
   t = float3::abs(C - Cright);
   delta[2] = vmax(t);
 
-  float3 Cbottom = tex.get_or_clamp(offset[1][2], offset[1][3]).get<0, 1, 2>();
+  float3 Cbottom = tex.fetch<W>(offset[1][2], offset[1][3]).template get<0, 1, 2>();
   t = float3::abs(C - Cbottom);
   delta[3] = vmax(t);
 
   // direct neighorhood max delta, overwrite delta.zw later
   float2 max_delta = float2::max(delta.get<0, 1>(), delta.get<2, 3>());
 
-  float3 Cleftleft = tex.get_or_clamp(offset[2][0], offset[2][1]).get<0, 1, 2>();
+  float3 Cleftleft = tex.fetch<W>(offset[2][0], offset[2][1]).template get<0, 1, 2>();
   t = float3::abs(C - Cleftleft);
   delta[2] = vmax(t);
 
-  float3 Ctoptop = tex.get_or_clamp(offset[2][2], offset[2][3]).get<0, 1, 2>();
+  float3 Ctoptop = tex.fetch<W>(offset[2][2], offset[2][3]).template get<0, 1, 2>();
   t = float3::abs(C - Ctoptop);
   delta[3] = vmax(t);
 
@@ -313,6 +318,62 @@ static float2 SMAAColorEdgeDetectionPS(size_t x, size_t y, float4 offset[3], fbu
 #undef vmax
 }
 
+// rec. 709 luma weights, same as the reference SMAA
+static const float3 luma_weights(0.2126f, 0.7152f, 0.0722f);
+
+// precomputes the luma plane used by SMAALumaEdgeDetectionPS, so that each of the six neighbour
+// fetches per pixel only has to touch a single float instead of a whole float4
+static void SMAALuma(fbuffer4 const& colors, fbuffer1& luma, SMAA::region r) {
+  typedef fbuffer1::pixel pixel;
+  luma.for_each_row(r.x0, r.y0, r.x1, r.y1, [&](pixel* out, pixel* end, size_t y) {
+    float4 const* C = &colors.cget(r.x0, y);
+    for (; out != end; out++, C++)
+      (*out)[0] = float3::dot(C->get<0, 1, 2>(), luma_weights);
+  });
+}
+
+template <typename W>
+static float2 SMAALumaEdgeDetectionPS(size_t x, size_t y, float4 offset[3], fbuffer1 const& luma) {
+  const float2 discard = float2{0.0f, 0.0f};
+
+  float2 threshold = float2(SMAA_SCALED_THRESHOLD, SMAA_SCALED_THRESHOLD);
+
+  float L = luma.cget(x, y)[0];
+
+  float Lleft = luma.fetch<W>(offset[0][0], offset[0][1])[0];
+  float Ltop = luma.fetch<W>(offset[0][2], offset[0][3])[0];
+
+  float4 delta;
+  delta.setv<0, 1>(float2::abs(L - float2(Lleft, Ltop)));
+
+  float2 edges = float2::step(threshold, delta.get<0, 1>());
+
+  // no edges, equivalent to discarding the fragment
+  if (edges[0] + edges[1] == 0.0f)
+    return discard;
+
+  float Lright = luma.fetch<W>(offset[1][0], offset[1][1])[0];
+  float Lbottom = luma.fetch<W>(offset[1][2], offset[1][3])[0];
+  delta.setv<2, 3>(float2::abs(L - float2(Lright, Lbottom)));
+
+  // direct neighorhood max delta
+  float2 max_delta = float2::max(delta.get<0, 1>(), delta.get<2, 3>());
+
+  // unlike the color port above, the reference compares left-left against left (and top-top
+  // against top) here rather than against the center pixel
+  float Lleftleft = luma.fetch<W>(offset[2][0], offset[2][1])[0];
+  float Ltoptop = luma.fetch<W>(offset[2][2], offset[2][3])[0];
+  delta.setv<2, 3>(float2::abs(float2(Lleft, Ltop) - float2(Lleftleft, Ltoptop)));
+
+  max_delta = float2::max(max_delta, delta.get<2, 3>());
+  float final_delta = std::max(max_delta[0], max_delta[1]);
+
+  // adaptive double threshold for local contrast
+  edges *= float2::step(final_delta, delta.get<0, 1>() * SMAA_LOCAL_CONTRAST_ADAPTATION_FACTOR);
+
+  return edges;
+}
+
 /* ========================================================================= */
 
 /* == PHASE 2 - Blending Weight Calculations =============================== */
@@ -405,7 +466,8 @@ static float2 SMAASearchDiag2(float x, float y, float2 dir, float2& e, fbuffer2
 
 static const float2 MAXAREADIAG2 =
     float2(SMAA_AREATEX_MAX_DISTANCE_DIAG, SMAA_AREATEX_MAX_DISTANCE_DIAG);
-static float2 SMAAAreaDiag(float2 dist, float2 e, float offset, fbuffer2 const& area) {
+template <typename AreaTex>
+static float2 SMAAAreaDiag(float2 dist, float2 e, float offset, AreaTex const& area) {
   float2 texcoord = MAXAREADIAG2 * e + dist;
   // texcoord += 0.5f; // bias
 
@@ -417,7 +479,8 @@ static float2 SMAAAreaDiag(float2 dist, float2 e, float offset, fbuffer2 const&
 }
 
 static const float2 MAXAREA2 = float2(SMAA_AREATEX_MAX_DISTANCE, SMAA_AREATEX_MAX_DISTANCE);
-float2 SMAAArea(float2 dist, float e1, float e2, float offset, fbuffer2 const& area) {
+template <typename AreaTex>
+static float2 SMAAArea(float2 dist, float e1, float e2, float offset, AreaTex const& area) {
   // round to avoid precision errors from bilinear filtering
   float2 texcoord = MAXAREA2 * (4.0f * float2(e1, e2)).round() + dist;
 
@@ -434,8 +497,9 @@ static const float2 d_left_down(-1.0f, 1.0f);
 static const float2 d_left_up(-1.0f, -1.0f);
 static const float2 d_right_down(1.0f, 1.0f);
 static const float2 d_right_up(1.0f, -1.0f);
+template <typename AreaTex>
 static float2 SMAACalculateDiagWeights(float x, float y, float2 e, float4 subsample_indices,
-                                       fbuffer2 const& edges, fbuffer2 const& area) {
+                                       fbuffer2 const& edges, AreaTex const& area) {
   float2 weights(0.0f);
 
   float4 d;
@@ -486,13 +550,14 @@ static float2 SMAACalculateDiagWeights(float x, float y, float2 e, float4 subsam
     float2 cc = two2 * c.get<0, 2>() + c.get<1, 3>();
     cc.movc(bool2(float2::step(0.9f, d.get<2, 3>())), zero2);
 
-    weights += SMAAAreaDiag(d.get<0, 1>(), cc, subsample_indices[3], area).get<1, 0>();
+    weights += SMAAAreaDiag(d.get<0, 1>(), cc, subsample_indices[3], area).template get<1, 0>();
   }
 
   return weights;
 }
 
-static float SMAASearchLength(float2 e, float offset, fbuffer1 const& search) {
+template <typename SearchTex>
+static float SMAASearchLength(float2 e, float offset, SearchTex const& search) {
   float2 scale = SMAA_SEARCHTEX_SIZE * float2(0.5, -1.0);
   float2 bias = SMAA_SEARCHTEX_SIZE * float2(offset, 1.0);
 
@@ -510,8 +575,9 @@ static float SMAASearchLength(float2 e, float offset, fbuffer1 const& search) {
   return len;
 }
 
+template <typename SearchTex>
 static float SMAASearchXLeft(float x, float y, float end, fbuffer2 const& edges,
-                             fbuffer1 const& search) {
+                             SearchTex const& search) {
 
   float2 e = float2(0.0f, 1.0f);
   while (x > end && e[1] > 0.8281f && // all edges activated ?
@@ -533,8 +599,9 @@ static float SMAASearchXLeft(float x, float y, float end, fbuffer2 const& edges,
   return offset + x;
 }
 
+template <typename SearchTex>
 static float SMAASearchXRight(float x, float y, float end, fbuffer2 const& edges,
-                              fbuffer1 const& search) {
+                              SearchTex const& search) {
 
   float2 e = float2(0.0f, 1.0f);
   while (x < end && e[1] > 0.8281 && // all edges activated ?
@@ -549,8 +616,9 @@ static float SMAASearchXRight(float x, float y, float end, fbuffer2 const& edges
   return -offset + x;
 }
 
+template <typename SearchTex>
 static float SMAASearchYUp(float x, float y, float end, fbuffer2 const& edges,
-                           fbuffer1 const& search) {
+                           SearchTex const& search) {
 
   float2 e = float2(1.0f, 0.0f);
   while (y > end && e[0] > 0.8281 && // all edges activated ?
@@ -566,8 +634,9 @@ static float SMAASearchYUp(float x, float y, float end, fbuffer2 const& edges,
   return offset + y;
 }
 
+template <typename SearchTex>
 static float SMAASearchYDown(float x, float y, float end, fbuffer2 const& edges,
-                             fbuffer1 const& search) {
+                             SearchTex const& search) {
 
   float2 e = float2(1.0f, 0.0f);
   while (y < end && e[0] > 0.8281 && // all edges activated ?
@@ -585,21 +654,14 @@ static float SMAASearchYDown(float x, float y, float end, fbuffer2 const& edges,
 #define SMAA_DISABLE_DIAG_DETECTION
 #undef SMAA_DISABLE_DIAG_DETECTION
 
-struct ds_t {
-  // const char* type;
-  size_t x, y;
-  float2 d;
-  float2 weights;
-};
-std::vector<ds_t> ds;
-
 // float4 offset[3]
 //   offset[0] = texcoord.xyxy + left-right offset
 //   offset[0] = texcoord.xyxy + up-down offset
 //   offset[2] = offset[0,1] + max search steps
+template <typename AreaTex, typename SearchTex>
 static float4 SMAABlendingWeightCalculation(size_t x, size_t y, float4 offset[3],
-                                            fbuffer2 const& edges, fbuffer2 const& area,
-                                            fbuffer1 const& search, float4 subsample_indices) {
+                                            fbuffer2 const& edges, AreaTex const& area,
+                                            SearchTex const& search, float4 subsample_indices) {
   float4 weights = float4(0.0f);
 
   float2 e = edges.cget(x, y);
@@ -642,7 +704,6 @@ static float4 SMAABlendingWeightCalculation(size_t x, size_t y, float4 offset[3]
       // retrieved pattern, now find area
       weights.setv<0, 1>(areav);
 
-      ds.push_back({x, y, d, weights.get<0, 1>()});
 
       // fix corners
       // coords[1] = y;
@@ -684,7 +745,6 @@ static float4 SMAABlendingWeightCalculation(size_t x, size_t y, float4 offset[3]
     // find area
     weights.setv<2, 3>(SMAAArea(sqrt_d, e1, e2, subsample_indices[0], area));
 
-    ds.push_back({x, y, d, weights.get<2, 3>()});
     // fix corners
     // coords[0] = x;
     // float2 weights_ba = weights.get<2,3>();
@@ -695,18 +755,41 @@ static float4 SMAABlendingWeightCalculation(size_t x, size_t y, float4 offset[3]
   return weights;
 }
 
-static float4 SMAANeighborhoodBlending(float x, float y, float4 offset, fbuffer4& colors,
-                                       fbuffer4& blending) {
+// bilinear sample at offset (dx, dy) from the pixel (x, y). Unlike sampling at x + dx, the
+// interpolation weights don't depend on the magnitude of x and y, so a pixel is filtered the same
+// no matter where it lies in the image, or in a tile of it
+template <typename W>
+static float4 SMAABilinearAt(fbuffer4 const& colors, float x, float y, float dx, float dy) {
+  float cx = std::floor(dx);
+  float cy = std::floor(dy);
+
+  float tx = dx - cx;
+  float ty = dy - cy;
+
+  cx += x;
+  cy += y;
+
+  float4 Ptl = colors.fetch<W>(cx, cy);
+  float4 Ptr = colors.fetch<W>(cx + 1, cy);
+  float4 Pbl = colors.fetch<W>(cx, cy + 1);
+  float4 Pbr = colors.fetch<W>(cx + 1, cy + 1);
+
+  return float4::lerp(ty, float4::lerp(tx, Ptl, Ptr), float4::lerp(tx, Pbl, Pbr));
+}
+
+template <typename W>
+static float4 SMAANeighborhoodBlending(float x, float y, float4 offset, fbuffer4 const& colors,
+                                       fbuffer4 const& blending) {
   // fetch blending weights for x,y
   float4 a;
-  a[0] = blending.get_or_def(offset[0], offset[1])[3]; // right
-  a[1] = blending.get_or_def(offset[2], offset[3])[1]; // top
-  a.setv<3, 2>(blending.get_or_def(x, y).get<0, 2>()); // bottom / left
+  a[0] = blending.fetch<W>(offset[0], offset[1])[3]; // right
+  a[1] = blending.fetch<W>(offset[2], offset[3])[1]; // top
+  a.setv<3, 2>(blending.fetch<W>(x, y).template get<0, 2>()); // bottom / left
 
   // is the sum of the blending weights less than some epsilon? (no blending to
   // do here)
   if (a.sum() < 1e-5) {
-    float4 color = colors.get(x, y);
+    float4 color = colors.cget(x, y);
     return color;
   } else {
     // max(horizontal) > max(vertical)
@@ -720,11 +803,12 @@ static float4 SMAANeighborhoodBlending(float x, float y, float4 offset, fbuffer4
     blending_weight.movc(bool2(h), a.get<0, 2>());
     blending_weight.normalize();
 
-    float4 blending_coord = blending_offset * float4(1.0, 1.0, -1.0, -1.0) + float4(x, y, x, y);
+    float4 blending_coord = blending_offset * float4(1.0, 1.0, -1.0, -1.0);
 
     float4 color =
-        blending_weight[0] * colors.get_bilinear_def(blending_coord[0], blending_coord[1]);
-    color += blending_weight[1] * colors.get_bilinear_def(blending_coord[2], blending_coord[3]);
+        blending_weight[0] * SMAABilinearAt<W>(colors, x, y, blending_coord[0], blending_coord[1]);
+    color +=
+        blending_weight[1] * SMAABilinearAt<W>(colors, x, y, blending_coord[2], blending_coord[3]);
 
     return color;
   }
@@ -732,7 +816,18 @@ static float4 SMAANeighborhoodBlending(float x, float y, float4 offset, fbuffer4
   return a;
 }
 
-SMAA::SMAA() {}
+const char* EDGE_DETECTION_NAMES[] = {
+  "Color",
+  "Luma",
+};
+
+const char* LOOKUP_PRECISION_NAMES[] = {
+  "U8",
+  "Float",
+};
+
+SMAA::SMAA(EDGE_DETECTION edge_detection, LOOKUP_PRECISION lookup_precision)
+    : edge_detection(edge_detection), lookup_precision(lookup_precision) {}
 
 static const float4 base_edge_offsets[3] = {float4{-1.0f, 0.0f, 0.0f, -1.0f},
                                             float4{1.0f, 0.0f, 0.0f, 1.0f},
@@ -742,54 +837,117 @@ static const float4 base_bw_offsets[3] = {float4{-0.25f, -0.125f, 1.25f, -0.125f
                                           float4{-0.125f, -0.25f, -0.125f, 1.25f},
                                           float4{-2.0f, 2.0f, -2.0f, 2.0f}};
 
+static const float4 base_nb_offsets(1.0f, 0.0f, 0.0f, 1.0f);
+
 /* ========================================================================= */
 
+// the furthest (in pixels) any sample of the edge detection and neighborhood blending passes reads
+// from the pixel being computed, pixels at least this far from the buffer's border are sampled
+// without any bounds checks
+#define SMAA_SAMPLE_REACH 2
+
+void SMAA::detect_edges(fbuffer4 const& colors, fbuffer1 const& luma, fbuffer2& edges,
+                        region r) const {
+  auto pass = [&](auto&& detect) {
+    edges.for_each_block<wrap_clamp>(
+        r.x0, r.y0, r.x1, r.y1, SMAA_SAMPLE_REACH,
+        [&](auto wrap, size_t x0, size_t y0, size_t x1, size_t y1) {
+          edges.for_each_row(x0, y0, x1, y1, [&](float2* out, float2* end, size_t y) {
+            for (size_t x = x0; out != end; out++, x++) {
+              float4 coords = float4{float(x), float(y), float(x), float(y)};
+              float4 offsets[3] = {
+                  // left, top
+                  base_edge_offsets[0] + coords,
+                  // right, bottom
+                  base_edge_offsets[1] + coords,
+                  // leftleft, toptop
+                  base_edge_offsets[2] + coords,
+              };
+
+              *out = detect(wrap, x, y, offsets);
+            }
+          });
+        });
+  };
+
+  if (edge_detection == LUMA_EDGES)
+    pass([&](auto wrap, size_t x, size_t y, float4* offsets) {
+      return SMAALumaEdgeDetectionPS<decltype(wrap)>(x, y, offsets, luma);
+    });
+  else
+    pass([&](auto wrap, size_t x, size_t y, float4* offsets) {
+      return SMAAColorEdgeDetectionPS<decltype(wrap)>(x, y, offsets, colors);
+    });
+}
+
+void SMAA::calculate_weights(fbuffer2 const& edges, fbuffer4& blending, region r) const {
+  auto pass = [&](auto const& area, auto const& search) {
+    blending.for_each_row(r.x0, r.y0, r.x1, r.y1, [&](float4* out, float4* end, size_t y) {
+      for (size_t x = r.x0; out != end; out++, x++) {
+        float4 coords = float4{float(x), float(y), float(x), float(y)};
+        float4 offsets[3] = {
+            base_bw_offsets[0] + coords,
+            base_bw_offsets[1] + coords,
+        };
+        offsets[2] = float4(base_bw_offsets[2] * float(SMAA_MAX_SEARCH_STEPS) +
+                            float4(offsets[0][0], offsets[0][2], offsets[1][1], offsets[1][3]));
+        *out = SMAABlendingWeightCalculation(x, y, offsets, edges, area, search, float4(0.0f));
+      }
+    });
+  };
+
+  if (lookup_precision == LOOKUP_FLOAT)
+    pass(area_buffer, search_buffer);
+  else
+    pass(area_lut, search_lut);
+}
+
+void SMAA::blend_neighborhood(fbuffer4 const& colors, fbuffer4 const& blending, fbuffer4& aabuffer,
+                              region r) const {
+  aabuffer.for_each_block<wrap_def>(
+      r.x0, r.y0, r.x1, r.y1, SMAA_SAMPLE_REACH,
+      [&](auto wrap, size_t x0, size_t y0, size_t x1, size_t y1) {
+        typedef decltype(wrap) W;
+        aabuffer.for_each_row(x0, y0, x1, y1, [&](float4* out, float4* end, size_t y) {
+          for (size_t x = x0; out != end; out++, x++) {
+            float4 coords = float4{float(x), float(y), float(x), float(y)};
+            float4 offset = base_nb_offsets + coords;
+
+            *out = SMAANeighborhoodBlending<W>(x, y, offset, colors, blending);
+          }
+        });
+      });
+}
+
 // todo: consider splitting each step into its own function with its own output
 // buffer... and maybe templating apply to specify which step to go to. makes it
 // easier to see intermediate steps.
 ibuffer4 SMAA::apply(fbuffer4 colors) {
+  size_t width = colors.get_width();
+  size_t height = colors.get_height();
+
+  if (tile_size > 0 && (width > tile_size || height > tile_size))
+    return apply_tiled(colors);
+  region all = {0, 0, width, height};
+
   fbuffer4 aabuffer(colors);
-  fbuffer2 edges(colors.get_width(), colors.get_height(), float2(0.0f));
-  fbuffer4 blending(colors.get_width(), colors.get_height(), float4(0.0f));
+  fbuffer2 edges(width, height, float2(0.0f));
+  fbuffer4 blending(width, height, float4(0.0f));
+
+  // only allocated when it is actually used
+  fbuffer1 luma(edge_detection == LUMA_EDGES ? width : 0,
+                edge_detection == LUMA_EDGES ? height : 0, fbuffer1::pixel(0.0f));
+  if (edge_detection == LUMA_EDGES)
+    SMAALuma(colors, luma, all);
 
   // 1. edge detection
-  auto end = colors.end();
-  for (auto it = colors.begin(); it != end; it++) {
-    float4 coords = float4{it.get_x(), it.get_y(), it.get_x(), it.get_y()};
-    float4 offsets[3] = {
-        // left, top
-        base_edge_offsets[0] + coords,
-        // right, bottom
-        base_edge_offsets[1] + coords,
-        // leftleft, toptop
-        base_edge_offsets[2] + coords,
-    };
-    edges.set(it.get_idx(), SMAAColorEdgeDetectionPS(it.get_x(), it.get_y(), offsets, colors));
-  }
+  detect_edges(colors, luma, edges, all);
 
   // 2. blending weight
-  for (auto it = colors.begin(); it != end; it++) {
-    float4 coords = float4{it.get_x(), it.get_y(), it.get_x(), it.get_y()};
-    float4 offsets[3] = {
-        base_bw_offsets[0] + coords,
-        base_bw_offsets[1] + coords,
-    };
-    offsets[2] = float4(base_bw_offsets[2] * float(SMAA_MAX_SEARCH_STEPS) +
-                        float4(offsets[0][0], offsets[0][2], offsets[1][1], offsets[1][3]));
-    blending.set(it.get_idx(),
-                 SMAABlendingWeightCalculation(it.get_x(), it.get_y(), offsets, edges, area_buffer,
-                                               search_buffer, float4(0.0f)));
-  }
+  calculate_weights(edges, blending, all);
 
   // 3. neighborhood blending
-  float4 base_offsets(1.0f, 0.0f, 0.0f, 1.0f);
-  for (auto it = colors.begin(); it != end; it++) {
-    float4 coords = float4{it.get_x(), it.get_y(), it.get_x(), it.get_y()};
-    float4 offset = base_offsets + coords;
-
-    aabuffer.set(it.get_idx(),
-                 SMAANeighborhoodBlending(it.get_x(), it.get_y(), offset, colors, blending));
-  }
+  blend_neighborhood(colors, blending, aabuffer, all);
 
   // auto bit = aabuffer.begin();
   //  auto eit = edges.begin();
@@ -837,7 +995,7 @@ ibuffer4 SMAA::apply(fbuffer4 colors) {
 
   // }
 
-  blending.apply([](auto p) {
+  blending.apply_par([](auto p) {
     return fbuffer4::pixel((p[0] + p[1]) * 120.0f, (p[2] + p[3]) * 120.0f, 0.0f,
                            p.sum() == 0.0f ? 0.0f : 255.0f);
   });
@@ -876,26 +1034,330 @@ ibuffer4 SMAA::apply(fbuffer4 colors) {
   return aabuffer.cast<int>();
 }
 
+/* == Incremental animation ================================================ */
+
+// size (in pixels) of the square tiles that changes between frames are tracked in
+#define SMAA_DIRTY_TILE 16
+
+// how far (in pixels) a changed color can reach into the edges, each edge reads its left/top
+// neighbours up to two pixels away and its right/bottom neighbours one pixel away
+#define SMAA_EDGES_REACH 2
+
+// how far a changed edge can reach into the blending weights. The horizontal/vertical searches
+// walk SMAA_MAX_SEARCH_STEPS steps of two pixels in each direction, then fetch the crossing edges
+// past the end of the line, while the diagonal searches walk SMAA_MAX_SEARCH_STEPS_DIAG pixels
+#define SMAA_WEIGHTS_REACH (2 * SMAA_MAX_SEARCH_STEPS + SMAA_MAX_SEARCH_STEPS_DIAG + 4)
+
+// how far a changed weight or color can reach into the blended colors
+#define SMAA_BLENDING_REACH 1
+
+namespace {
+
+// one flag per SMAA_DIRTY_TILE x SMAA_DIRTY_TILE tile of the image
+struct tile_mask {
+  size_t width, height; // in tiles
+  std::vector<char> tiles;
+
+  tile_mask(size_t width, size_t height, char val = 0)
+      : width(width), height(height), tiles(width * height, val) {}
+
+  inline char& at(size_t tx, size_t ty) { return tiles[ty * width + tx]; }
+  inline char at(size_t tx, size_t ty) const { return tiles[ty * width + tx]; }
+
+  // marks every tile that is within reach pixels of an already marked one
+  tile_mask dilate(size_t reach) const {
+    size_t r = (reach + SMAA_DIRTY_TILE - 1) / SMAA_DIRTY_TILE;
+
+    // separable, first along x then along y
+    tile_mask horizontal(width, height);
+    for (size_t ty = 0; ty < height; ty++) {
+      for (size_t tx = 0; tx < width; tx++) {
+        if (!at(tx, ty))
+          continue;
+        size_t from = tx > r ? tx - r : 0;
+        size_t to = std::min(tx + r + 1, width);
+        for (size_t x = from; x < to; x++)
+          horizontal.at(x, ty) = 1;
+      }
+    }
+
+    tile_mask dilated(width, height);
+    for (size_t ty = 0; ty < height; ty++) {
+      for (size_t tx = 0; tx < width; tx++) {
+        if (!horizontal.at(tx, ty))
+          continue;
+        size_t from = ty > r ? ty - r : 0;
+        size_t to = std::min(ty + r + 1, height);
+        for (size_t y = from; y < to; y++)
+          dilated.at(tx, y) = 1;
+      }
+    }
+
+    return dilated;
+  }
+
+  tile_mask& operator|=(tile_mask const& other) {
+    for (size_t i = 0; i < tiles.size(); i++)
+      tiles[i] |= other.tiles[i];
+    return *this;
+  }
+
+  // pixel regions of every marked tile, clipped to the image
+  std::vector<SMAA::region> regions(size_t image_width, size_t image_height) const {
+    std::vector<SMAA::region> marked;
+    for (size_t ty = 0; ty < height; ty++) {
+      for (size_t tx = 0; tx < width; tx++) {
+        if (!at(tx, ty))
+          continue;
+        marked.push_back({tx * SMAA_DIRTY_TILE, ty * SMAA_DIRTY_TILE,
+                          std::min((tx + 1) * SMAA_DIRTY_TILE, image_width),
+                          std::min((ty + 1) * SMAA_DIRTY_TILE, image_height)});
+      }
+    }
+    return marked;
+  }
+};
+
+} // namespace
+
+std::vector<ibuffer4> SMAA::apply_animation(std::vector<fbuffer4> const& frames) const {
+  std::vector<ibuffer4> results;
+  if (frames.empty())
+    return results;
+
+  size_t width = frames[0].get_width();
+  size_t height = frames[0].get_height();
+  size_t twidth = (width + SMAA_DIRTY_TILE - 1) / SMAA_DIRTY_TILE;
+  size_t theight = (height + SMAA_DIRTY_TILE - 1) / SMAA_DIRTY_TILE;
+
+  bool luma_edges = edge_detection == LUMA_EDGES;
+
+  // these all persist between frames, only the dirty parts of them get overwritten
+  fbuffer4 aabuffer(width, height, float4(0.0f));
+  fbuffer2 edges(width, height, float2(0.0f));
+  fbuffer4 blending(width, height, float4(0.0f));
+  fbuffer1 luma(luma_edges ? width : 0, luma_edges ? height : 0, fbuffer1::pixel(0.0f));
+
+  thread_pool& pool = thread_pool::shared();
+
+  // the tiles of a single pass never overlap, so each of them can be handled by its own worker
+  auto run = [&](tile_mask const& mask, auto&& pass) {
+    auto regions = mask.regions(width, height);
+    pool.parallel_for(0, regions.size(), [&](size_t i) { pass(regions[i]); });
+  };
+
+  results.reserve(frames.size());
+  for (size_t f = 0; f < frames.size(); f++) {
+    fbuffer4 const& colors = frames[f];
+
+    if (colors.get_width() != width || colors.get_height() != height) {
+      throw std::invalid_argument{"trying to apply SMAA to an animation with frames of "
+                                  "differing sizes"};
+    }
+
+    tile_mask changed(twidth, theight, f == 0);
+
+    if (f > 0) {
+      fbuffer4 const& previous = frames[f - 1];
+      pool.parallel_for(0, theight, [&](size_t ty) {
+        size_t yend = std::min((ty + 1) * SMAA_DIRTY_TILE, height);
+        for (size_t y = ty * SMAA_DIRTY_TILE; y < yend; y++) {
+          for (size_t x = 0; x < width; x++) {
+            float4 const& p = colors.cget(x, y);
+            float4 const& q = previous.cget(x, y);
+            if (p[0] != q[0] || p[1] != q[1] || p[2] != q[2] || p[3] != q[3])
+              changed.at(x / SMAA_DIRTY_TILE, ty) = 1;
+          }
+        }
+      });
+    }
+
+    tile_mask dirty_edges = changed.dilate(SMAA_EDGES_REACH);
+    tile_mask dirty_weights = dirty_edges.dilate(SMAA_WEIGHTS_REACH);
+    tile_mask dirty_colors = dirty_weights;
+    dirty_colors |= changed;
+    dirty_colors = dirty_colors.dilate(SMAA_BLENDING_REACH);
+
+    if (luma_edges)
+      run(changed, [&](region r) { SMAALuma(colors, luma, r); });
+
+    // 1. edge detection
+    run(dirty_edges, [&](region r) { detect_edges(colors, luma, edges, r); });
+
+    // 2. blending weight
+    run(dirty_weights, [&](region r) { calculate_weights(edges, blending, r); });
+
+    // 3. neighborhood blending
+    run(dirty_colors, [&](region r) { blend_neighborhood(colors, blending, aabuffer, r); });
+
+    results.push_back(aabuffer.cast<int>());
+  }
+
+  return results;
+}
+
+/* == Tiled ================================================================ */
+
+namespace {
+
+// grows r by reach pixels on every side, clipped to the image
+SMAA::region grow(SMAA::region r, size_t reach, size_t width, size_t height) {
+  return {r.x0 > reach ? r.x0 - reach : 0, r.y0 > reach ? r.y0 - reach : 0,
+          std::min(r.x1 + reach, width), std::min(r.y1 + reach, height)};
+}
+
+// r moved into the coordinates of a buffer whose top left corner is at (x0, y0)
+SMAA::region local_to(SMAA::region r, size_t x0, size_t y0) {
+  return {r.x0 - x0, r.y0 - y0, r.x1 - x0, r.y1 - y0};
+}
+
+} // namespace
+
+ibuffer4 SMAA::apply_tiled(fbuffer4 const& colors) const {
+  size_t width = colors.get_width();
+  size_t height = colors.get_height();
+  size_t tile = tile_size;
+
+  size_t twidth = (width + tile - 1) / tile;
+  size_t theight = (height + tile - 1) / tile;
+
+  bool luma_edges = edge_detection == LUMA_EDGES;
+
+  ibuffer4 result(width, height, int4(0));
+
+  thread_pool::shared().parallel_for(0, twidth * theight, [&](size_t t) {
+    size_t tx = t % twidth;
+    size_t ty = t / twidth;
+
+    // work backwards from the pixels this tile outputs to everything that they depend on
+    region core = {tx * tile, ty * tile, std::min((tx + 1) * tile, width),
+                   std::min((ty + 1) * tile, height)};
+    region weights = grow(core, SMAA_BLENDING_REACH, width, height);
+    region edges = grow(weights, SMAA_WEIGHTS_REACH, width, height);
+    region halo = grow(edges, SMAA_EDGES_REACH, width, height);
+
+    size_t lwidth = halo.x1 - halo.x0;
+    size_t lheight = halo.y1 - halo.y0;
+
+    // the halo is clipped the same way as the image, so anything read past the border of the
+    // local buffers is either outside of the image as well, or only feeds into pixels that are
+    // outside of the regions below
+    fbuffer4 lcolors(lwidth, lheight, float4(0.0f));
+    lcolors.for_each_row([&](float4* out, float4* end, size_t y) {
+      float4 const* src = &colors.cget(halo.x0, halo.y0 + y);
+      std::copy(src, src + (end - out), out);
+    });
+
+    fbuffer2 ledges(lwidth, lheight, float2(0.0f));
+    fbuffer4 lblending(lwidth, lheight, float4(0.0f));
+    fbuffer4 laabuffer(lwidth, lheight, float4(0.0f));
+    fbuffer1 lluma(luma_edges ? lwidth : 0, luma_edges ? lheight : 0, fbuffer1::pixel(0.0f));
+
+    if (luma_edges)
+      SMAALuma(lcolors, lluma, {0, 0, lwidth, lheight});
+
+    // 1. edge detection
+    detect_edges(lcolors, lluma, ledges, local_to(edges, halo.x0, halo.y0));
+
+    // 2. blending weight
+    calculate_weights(ledges, lblending, local_to(weights, halo.x0, halo.y0));
+
+    // 3. neighborhood blending
+    region lcore = local_to(core, halo.x0, halo.y0);
+    blend_neighborhood(lcolors, lblending, laabuffer, lcore);
+
+    result.for_each_row(core.x0, core.y0, core.x1, core.y1, [&](int4* out, int4* end, size_t y) {
+      float4 const* src = &laabuffer.cget(lcore.x0, y - halo.y0);
+      for (; out != end; out++, src++)
+        *out = int4(*src);
+    });
+  });
+
+  return result;
+}
+
 #define GET_NUMBER(idx, field, key)                                                                \
   if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                                    \
-    W.field = luaL_checknumber(L, -1);                                                             \
-    lua_pop(L, 1);                                                                                 \
-  }
+    S.field = luaL_checknumber(L, -1);                                                             \
+  }                                                                                                \
+  lua_pop(L, 1);
 #define GET_INTEGER(idx, field, key)                                                               \
   if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                                    \
-    W.field = luaL_checkinteger(L, -1);                                                            \
-    lua_pop(L, 1);                                                                                 \
-  }
+    S.field = luaL_checkinteger(L, -1);                                                            \
+  }                                                                                                \
+  lua_pop(L, 1);
+#define GET_BOOLEAN(idx, field, key)                                                               \
+  if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                                    \
+    S.field = lua_toboolean(L, -1);                                                                \
+  }                                                                                                \
+  lua_pop(L, 1);
 #define GET_ENUM(idx, ENUM, enum_last, field, key)                                                 \
   if (lua_getfield(L, idx, #key) != LUA_TNIL) {                                                    \
     int val = luaL_checkinteger(L, -1);                                                            \
     if (val < 0 || val >= enum_last)                                                               \
       luaL_error(L, "invalid enum value passed as field");                                         \
-    W.field = (ENUM)val;                                                                           \
-    lua_pop(L, 1);                                                                                 \
+    S.field = (ENUM)val;                                                                           \
+  }                                                                                                \
+  lua_pop(L, 1);
+
+void SMAA::load_options(lua_State* L, int idx) {
+  SMAA& S = *this;
+
+  GET_ENUM(idx, EDGE_DETECTION, EDGE_DETECTION_LAST, edge_detection, edge_detection);
+  GET_ENUM(idx, LOOKUP_PRECISION, LOOKUP_PRECISION_LAST, lookup_precision, lookup_precision);
+  GET_BOOLEAN(idx, incremental, incremental);
+  GET_INTEGER(idx, tile_size, tile_size);
+  GET_ENUM(idx, ARRAY_TYPE, ARRAY_TYPE_LAST, array_type, array_type);
+}
+
+// loads a single RGBA frame from the stack, either as a table of numbers (e.g., IBuffer.elements)
+// or as a string of bytes (e.g., Image.bytes)
+static fbuffer4 load_frame(lua_State* L, int idx, size_t width, size_t height) {
+  size_t length = width * height * 4;
+
+  if (lua_type(L, idx) == LUA_TSTRING) {
+    size_t actual_length;
+    auto bytes = (const unsigned char*)lua_tolstring(L, idx, &actual_length);
+
+    if (length != actual_length)
+      luaL_error(L, "SMAA frame size differs from width * height * 4");
+
+    return fbuffer4(width, height, vec{0, 0, 0, 255}, bytes, bytes + length);
   }
 
-// parameters: buffer, width, height, opts
+  luaL_checktype(L, idx, LUA_TTABLE);
+
+  size_t actual_length = luaL_len(L, idx);
+  if (length != actual_length)
+    luaL_error(L, "SMAA frame size differs from width * height * 4");
+
+  fbuffer4 buffer(width, height, vec{0, 0, 0, 255});
+  buffer.set_from(try_load_array<float>(L, idx, 1, length + 1));
+
+  return buffer;
+}
+
+// copies an SMAA result into an larray of the given type and leaves it on top of the stack. The
+// value at stack index into is reused if it is an larray of that type and size
+static void push_result(lua_State* L, ibuffer4& aabuffer, ARRAY_TYPE type, int into) {
+  size_t length = aabuffer.get_extended_length();
+  auto const& elements = aabuffer.data();
+
+  visit_array_type(type, [&](auto tag) {
+    typedef typename decltype(tag)::type T;
+
+    // return an larray for efficiency
+    auto arr = larray<T>::push_or_reuse(L, into, length);
+
+    for (size_t i = 0; i < elements.size(); i++) {
+      for (size_t c = 0; c < 4; c++)
+        arr->values[i * 4 + c] = larray_cast<T>(elements[i][c]);
+    }
+  });
+}
+
+// parameters: width, height, buffer, opts, into
+// into is optional, an larray of the requested type and size whose memory is reused for the result
 int l_SMAA(lua_State* L) {
   size_t width;
   size_t height;
@@ -903,45 +1365,86 @@ int l_SMAA(lua_State* L) {
   width = luaL_checknumber(L, 1);
   height = luaL_checknumber(L, 2);
 
-  size_t length = width * height * 4;
+  SMAA S;
 
-  lua_len(L, 3);
-  size_t actual_length = lua_tonumber(L, -1);
-  lua_pop(L, 1);
+  if (lua_istable(L, 4))
+    S.load_options(L, 4);
 
-  if (length != actual_length)
-    lua_error(L);
+  fbuffer4 buffer = load_frame(L, 3, width, height);
 
-  auto orig_arr = try_load_array<float>(L, 3, 1, length + 1);
+  ibuffer4 aabuffer = S.apply(buffer);
 
-  fbuffer4 buffer(width, height, vec{0, 0, 0, 255});
-  buffer.set_from(orig_arr);
+  push_result(L, aabuffer, S.get_array_type(), 5);
+
+  return 1;
+}
+
+// parameters: width, height, frames, opts, into
+// frames is a table of frames, each in any of the forms accepted by l_SMAA. The frames are
+// filtered concurrently on the shared thread pool (the area/search textures are read-only, so they
+// are shared between all of them), and returned in order as a table of larrays. If into is given,
+// the results are written to (and the larrays reused from) that table instead of a new one.
+int l_SMAA_batch(lua_State* L) {
+  size_t width;
+  size_t height;
+
+  width = luaL_checknumber(L, 1);
+  height = luaL_checknumber(L, 2);
+  luaL_checktype(L, 3, LUA_TTABLE);
 
-  SMAA smaa;
-  ibuffer4 aabuffer = smaa.apply(buffer);
+  SMAA S;
 
-  // buffer.fill(vec<int,4>{ 255, 255, 0, 255 });
+  if (lua_istable(L, 4))
+    S.load_options(L, 4);
 
-  // return an ldarray for efficiency
-  lua_getglobal(L, "ldarray");
+  size_t nframes = luaL_len(L, 3);
 
-  // add ldarray size argument to stack
-  lua_pushinteger(L, length);
+  // Lua is not thread-safe, so every frame is loaded before starting any of the workers
+  std::vector<fbuffer4> frames;
+  frames.reserve(nframes);
+  for (size_t i = 0; i < nframes; i++) {
+    lua_geti(L, 3, i + 1);
+    frames.push_back(load_frame(L, -1, width, height));
+    lua_pop(L, 1);
+  }
 
-  // call ldarray constructor
-  if (lua_pcall(L, 1, 1, 0) != LUA_OK)
-    return 0;
+  std::vector<std::optional<ibuffer4>> results(nframes);
+
+  try {
+    if (S.is_incremental()) {
+      // frames depend on each other here, parallelism happens within each frame instead
+      auto animation = S.apply_animation(frames);
+      for (size_t i = 0; i < nframes; i++)
+        results[i].emplace(std::move(animation[i]));
+    } else {
+      thread_pool::shared().parallel_for(0, nframes, [&](size_t i) {
+        results[i].emplace(S.apply(std::move(frames[i])));
+      });
+    }
+  } catch (std::exception const& e) {
+    return luaL_error(L, "SMAA batch failed: %s", e.what());
+  }
 
-  auto arr = get_obj<larray<double>>(L, -1);
+  if (lua_istable(L, 5))
+    lua_pushvalue(L, 5);
+  else
+    lua_createtable(L, nframes, 0);
+  int into = lua_gettop(L);
 
-  // sanity check
-  LASSERT(arr->size == length, "unexpected error, array size differs from SMAA buffer");
+  for (size_t i = 0; i < nframes; i++) {
+    lua_geti(L, into, i + 1);
+    push_result(L, *results[i], S.get_array_type(), -1);
+    results[i].reset();
 
-  arr->from(aabuffer.to_arr());
+    // results[i+1] = arr
+    lua_seti(L, into, i + 1);
+    lua_pop(L, 1);
+  }
 
   return 1;
 }
 
 #undef GET_ENUM
+#undef GET_BOOLEAN
 #undef GET_INTEGER
 #undef GET_NUMBER
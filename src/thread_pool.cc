@@ -0,0 +1,53 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(size_t nthreads) {
+  if (nthreads == 0)
+    nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+  workers.reserve(nthreads);
+  for (size_t i = 0; i < nthreads; i++)
+    workers.emplace_back([this]() { work(); });
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+
+  for (auto& worker : workers)
+    worker.join();
+}
+
+void thread_pool::work() {
+  for (;;) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+      if (stopping && tasks.empty())
+        return;
+
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+
+    task();
+  }
+}
+
+void thread_pool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push(std::move(task));
+  }
+  cv.notify_one();
+}
+
+thread_pool& thread_pool::shared() {
+  static thread_pool pool;
+  return pool;
+}
@@ -0,0 +1,210 @@
+#include "voronoi.h"
+
+#include "larray.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+site_grid::site_grid(std::vector<double> xs_, std::vector<double> ys_, DISTANCE_FUNC distance_func)
+    : xs(std::move(xs_)), ys(std::move(ys_)), distance_func(distance_func) {
+  if (xs.size() != ys.size())
+    throw std::invalid_argument{"site_grid needs as many x as y positions, got " +
+                                std::to_string(xs.size()) + " and " + std::to_string(ys.size())};
+  if (xs.empty())
+    throw std::invalid_argument{"site_grid needs at least one site"};
+
+  auto [xlo, xhi] = std::minmax_element(xs.begin(), xs.end());
+  auto [ylo, yhi] = std::minmax_element(ys.begin(), ys.end());
+  double width = *xhi - *xlo;
+  double height = *yhi - *ylo;
+  double n = (double)xs.size();
+
+  // about one site per bin, also when the sites are all along a line
+  bin = std::max({std::sqrt(width * height / n), std::max(width, height) / n, 1e-9});
+  left = *xlo;
+  top = *ylo;
+  cols = (long long)(width / bin) + 1;
+  rows = (long long)(height / bin) + 1;
+
+  auto bin_of = [&](size_t i) {
+    long long bx = std::min((long long)((xs[i] - left) / bin), cols - 1);
+    long long by = std::min((long long)((ys[i] - top) / bin), rows - 1);
+    return (size_t)(by * cols + bx);
+  };
+
+  // counting sort by bin, which keeps the sites of a bin in their original order
+  starts.assign((size_t)(cols * rows) + 1, 0);
+  for (size_t i = 0; i < xs.size(); i++)
+    starts[bin_of(i) + 1]++;
+  for (size_t b = 1; b < starts.size(); b++)
+    starts[b] += starts[b - 1];
+
+  order.resize(xs.size());
+  std::vector<size_t> next(starts.begin(), starts.end() - 1);
+  for (size_t i = 0; i < xs.size(); i++)
+    order[next[bin_of(i)]++] = i;
+}
+
+size_t site_grid::nearest(double x, double y) const {
+  // points outside of the grid start from the closest bin on its edge
+  long long cx = (long long)std::clamp(std::floor((x - left) / bin), 0.0, (double)(cols - 1));
+  long long cy = (long long)std::clamp(std::floor((y - top) / bin), 0.0, (double)(rows - 1));
+
+  size_t best = 0;
+  double best_rank = std::numeric_limits<double>::infinity();
+
+  auto search_bin = [&](long long bx, long long by) {
+    size_t b = (size_t)(by * cols + bx);
+    for (size_t k = starts[b]; k < starts[b + 1]; k++) {
+      size_t i = order[k];
+      double rank = rank_of(xs[i] - x, ys[i] - y);
+      if (rank < best_rank || (rank == best_rank && i < best)) {
+        best = i;
+        best_rank = rank;
+      }
+    }
+  };
+
+  for (long long r = 0;; r++) {
+    // bins at a Chebyshev distance of r from cx, cy: full rows at the top and bottom of the ring,
+    // only both ends of the ones in between
+    long long bx0 = std::max(cx - r, 0LL), bx1 = std::min(cx + r, cols - 1);
+    long long by0 = std::max(cy - r, 0LL), by1 = std::min(cy + r, rows - 1);
+    for (long long by = by0; by <= by1; by++) {
+      if (by == cy - r || by == cy + r) {
+        for (long long bx = bx0; bx <= bx1; bx++)
+          search_bin(bx, by);
+      } else {
+        if (cx - r >= 0)
+          search_bin(cx - r, by);
+        if (r > 0 && cx + r < cols)
+          search_bin(cx + r, by);
+      }
+    }
+
+    // any site outside of the bins searched so far is at least as far as the closest edge of them
+    // that still has bins beyond it
+    double gap = std::numeric_limits<double>::infinity();
+    if (cx - r > 0)
+      gap = std::min(gap, x - (left + (double)(cx - r) * bin));
+    if (cx + r < cols - 1)
+      gap = std::min(gap, left + (double)(cx + r + 1) * bin - x);
+    if (cy - r > 0)
+      gap = std::min(gap, y - (top + (double)(cy - r) * bin));
+    if (cy + r < rows - 1)
+      gap = std::min(gap, top + (double)(cy + r + 1) * bin - y);
+
+    // every bin has been searched
+    if (gap == std::numeric_limits<double>::infinity())
+      break;
+
+    // along a single axis both distances are the same, so gap bounds either of them from below
+    if (gap > 0 && best_rank < rank_of(gap, 0))
+      break;
+  }
+
+  return best;
+}
+
+void voronoi_graph(site_grid const& grid, size_t width, size_t height, double left, double top,
+                   double out[]) {
+  thread_pool::shared().parallel_for(0, height, [&](size_t y) {
+    double* row = out + y * width;
+    for (size_t x = 0; x < width; x++)
+      row[x] = (double)(grid.nearest(left + (double)x, top + (double)y) + 1);
+  });
+}
+
+// pushes a table of the {x, y} centroid of every site's pixels in graph
+static void push_centroids(lua_State* L, site_grid const& grid, double const graph[],
+                           size_t width, size_t height, double left, double top) {
+  std::vector<double> sumx(grid.size()), sumy(grid.size());
+  std::vector<size_t> count(grid.size());
+  for (size_t y = 0; y < height; y++)
+    for (size_t x = 0; x < width; x++) {
+      size_t site = (size_t)graph[y * width + x] - 1;
+      sumx[site] += left + (double)x;
+      sumy[site] += top + (double)y;
+      count[site]++;
+    }
+
+  lua_createtable(L, (int)grid.size(), 0);
+  for (size_t i = 0; i < grid.size(); i++) {
+    // a site that lost every pixel to its neighbours stays put, rather than becoming 0/0
+    double cx = count[i] > 0 ? sumx[i] / (double)count[i] : grid.site_x(i);
+    double cy = count[i] > 0 ? sumy[i] / (double)count[i] : grid.site_y(i);
+
+    lua_createtable(L, 2, 0);
+    lua_pushnumber(L, cx);
+    lua_seti(L, -2, 1);
+    lua_pushnumber(L, cy);
+    lua_seti(L, -2, 2);
+
+    // centroids[i+1] = { cx, cy }
+    lua_seti(L, -2, (lua_Integer)i + 1);
+  }
+}
+
+int l_voronoi(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+
+  lua_Integer width = 0;
+  lua_Integer height = 0;
+  double left = 0;
+  double top = 0;
+  lua_Integer distance_func = EUCLIDIAN;
+
+  try_get_num_field(L, width, 1, -1, "width");
+  try_get_num_field(L, height, 1, -1, "height");
+  try_get_num_field(L, left, 1, -1, "left");
+  try_get_num_field(L, top, 1, -1, "top");
+  try_get_num_field(L, distance_func, 1, -1, "distance_func");
+
+  lua_getfield(L, 1, "centroids");
+  bool centroids = lua_toboolean(L, -1);
+  lua_pop(L, 1);
+
+  if (width < 0 || height < 0)
+    luaL_error(L, "voronoi width and height can't be negative");
+  if (distance_func < 0 || distance_func >= DISTANCE_LAST)
+    luaL_error(L, "invalid enum value passed as distance_func");
+
+  // sites: { {x, y}, ... }
+  if (lua_getfield(L, 1, "sites") != LUA_TTABLE)
+    luaL_error(L, "voronoi expects sites to be a table of {x, y} tables");
+
+  size_t n = (size_t)luaL_len(L, -1);
+  if (n == 0)
+    luaL_error(L, "voronoi needs at least one site");
+
+  std::vector<double> xs(n), ys(n);
+  for (size_t i = 0; i < n; i++) {
+    if (lua_geti(L, -1, (lua_Integer)i + 1) != LUA_TTABLE)
+      luaL_error(L, "voronoi site %d is not a {x, y} table", (int)i + 1);
+
+    lua_geti(L, -1, 1);
+    xs[i] = luaL_checknumber(L, -1);
+    lua_geti(L, -2, 2);
+    ys[i] = luaL_checknumber(L, -1);
+    lua_pop(L, 3);
+  }
+  lua_pop(L, 1);
+
+  site_grid grid(std::move(xs), std::move(ys), (DISTANCE_FUNC)distance_func);
+
+  size_t w = (size_t)width, h = (size_t)height;
+  larray<double>* arr = larray<double>::push(L, w * h);
+  voronoi_graph(grid, w, h, left, top, arr->values);
+
+  if (!centroids)
+    return 1;
+
+  push_centroids(L, grid, arr->values, w, h, left, top);
+  return 2;
+}
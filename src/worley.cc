@@ -15,7 +15,6 @@
 #include <set>
 #include <sstream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 DECLARE_LUA_CLASS_NAMED(Worley, Worley);
@@ -23,7 +22,6 @@ DECLARE_LUA_CLASS_NAMED(Worley, Worley);
 #define GET_IDX(x, y) ((y)*width + (x))
 
 typedef std::vector<dvec3> points_t;
-typedef std::unordered_map<dvec3, points_t> cache_t;
 
 size_t Worley::get_result_size() const { return width * height * n; }
 
@@ -34,118 +32,153 @@ static unsigned int gen_points(unsigned int seed, double mean, double min,
   return d(gen);
 }
 
+// points are relative to corner
 template <size_t N>
 static inline void calc_dists(distance_func_t distf, isort<double, N>& dists,
-                              dvec3& center, points_t& points) {
+                              dvec3 const& center, dvec3 const& corner, points_t const& points) {
   for (dvec3 const& v : points) {
-    double d = distf(v.x, v.y, v.z, center.x, center.y, center.z);
+    double d = distf(v.x + corner.x, v.y + corner.y, v.z + corner.z, center.x, center.y, center.z);
     dists.insert(d);
   }
 }
 
-template <size_t N>
-void Worley::compute_frame(cache_t& cache, double z, double values[]) const {
+Worley::points_t Worley::point_generator::operator()(lattice_cell<3> const& cell) const {
+  ivec3 icell(cell[0], cell[1], cell[2]);
+
   /* initialize random distributions  */
-  std::mt19937 gen;
+  std::mt19937 gen(ltc.cell_seed(icell)); // set seed using lattice
   std::poisson_distribution<> d(mean_points);
   // dist used to generate x,y,z offset inside of a cell
-  std::uniform_real_distribution<> u(0.0, cellsize);
+  std::uniform_real_distribution<> u(0.0, ltc.get_cellsize());
+
+  size_t npoints = d(gen); // generate # of points using poisson
+
+  points_t points;
+  points.reserve(npoints);
+
+  for (size_t i = 0; i < npoints; i++) {
+    // uniformly generate coordinates for each of n points
+    points.push_back(dvec3(u(gen), u(gen), u(gen)));
+  }
 
+  return points;
+}
+
+lattice3 Worley::get_lattice() const {
   lattice3 ltc(cellsize, freq);
   ltc.set_seed(seed);
+  return ltc;
+}
+
+Worley::cache_t Worley::make_cache(lattice3 const& ltc, double width, double height,
+                                   double mean_points) {
+  // every pixel reads the cells around its own
+  ivec3 lo = ltc.cell_of(0, 0, 0);
+  ivec3 hi = ltc.cell_of(std::max(width - 1, 0.0), std::max(height - 1, 0.0), 0);
+
+  return cache_t({lo.x - 1, lo.y - 1, 0}, {hi.x + 1, hi.y + 1, 0}, {ltc, mean_points});
+}
+
+bool Worley::is_periodic(lattice3 const& ltc) {
+  ivec3 period = ltc.get_period();
+
+  if (period.x == 0 || period.y == 0 || period.z == 0)
+    return false;
+
+  return (size_t)period.x * period.y * period.z <= MAX_PERIODIC_CELLS;
+}
+
+bool Worley::cache_key::operator==(cache_key const& other) const {
+  return seed == other.seed && cellsize == other.cellsize && mean_points == other.mean_points &&
+         freq == other.freq && width == other.width && height == other.height;
+}
+
+Worley::cache_key Worley::get_cache_key() const {
+  return {seed, cellsize, mean_points, freq, width, height};
+}
+
+void Worley::validate_cache() {
+  cache_key key = get_cache_key();
+  if (key == cached_for)
+    return;
+
+  cell_cache.reset();
+  periodic_cell_cache.reset();
+  cached_for = key;
+}
+
+Worley::periodic_cache_t Worley::make_periodic_cache(lattice3 const& ltc, double mean_points) {
+  ivec3 period = ltc.get_period();
+  return periodic_cache_t({period.x, period.y, period.z}, {ltc, mean_points});
+}
+
+template <size_t N, typename T, typename Cache>
+void Worley::compute_frame(Cache& cache, double z, T values[]) const {
+  lattice3 const& ltc = cache.get_generator().ltc;
 
   distance_func_t distf = distance_funcs[distance_func];
 
+  // the cells of every column are the same on each row, and the cells of every row the same on
+  // each column, so they are looked up once per frame instead of once per pixel
+  std::vector<long long> xcells((size_t)width);
+  std::vector<long long> ycells((size_t)height);
+  ltc.cells_along(0, xcells.size(), xcells.data());
+  ltc.cells_along(0, ycells.size(), ycells.data());
+  long long zcell = ltc.cell_of(z);
+
+  // every cell this frame can read is generated up front (a no-op if the whole lattice is
+  // precomputed), which leaves only lookups below. Slabs behind this frame are dropped, so long
+  // animations only ever keep the three slabs of the current frame around
+  cache.advance(zcell - 1, zcell + 1);
+  points_t const* slabs[3];
+  double zcorners[3];
+  for (long long dz = -1; dz <= 1; dz++) {
+    slabs[dz + 1] = cache.slab_data(zcell + dz);
+    zcorners[dz + 1] = ltc.corner_of({0, 0, zcell + dz}).z;
+  }
+
+  // offsets of the neighbouring cells along x and y, these are where the lattice wraps, if it does
+  std::vector<std::array<size_t, 3>> xoffsets(xcells.size());
+  for (size_t x = 0; x < xcells.size(); x++)
+    for (long long dx = -1; dx <= 1; dx++)
+      xoffsets[x][dx + 1] = cache.axis_offset(0, xcells[x] + dx);
+
   dvec3 center{0, 0, z};
-  for (double y = 0; y < height; y++) {
-    size_t scanned = y * width;
+  for (size_t y = 0; y < (size_t)height; y++) {
+    size_t scanned = y * (size_t)width;
     center.y = y;
 
-    for (double x = 0; x < width; x++) {
-      size_t idx = scanned + (size_t)x;
-      dvec3 cell = ltc.get_corner(x, y, z);
+    size_t yoffsets[3];
+    for (long long dy = -1; dy <= 1; dy++)
+      yoffsets[dy + 1] = cache.axis_offset(1, ycells[y] + dy);
+
+    for (size_t x = 0; x < (size_t)width; x++) {
+      size_t idx = scanned + x;
       center.x = x;
       isort<double, N> dists;
 
-      // test point does two things: it caches points assigned to each lattice
-      // cell, and then it calculates the distance between pixel x,y,z and the
-      // nearest points
-      auto test_point = [&](dvec3 const& cell) {
-        if (!cache.count(cell)) { // generate points, since we couldn't find
-                                  // them in the cache
-          cache[cell] = points_t{};
-          points_t& points = cache[cell];
-
-          auto grid_seed = ltc.get_seed(cell.x, cell.y, cell.z);
-          gen.seed(grid_seed); // set seed using lattice
-          d.reset();
-          u.reset();
-
-          size_t npoints = d(gen); // generate # of points using poisson
-
-          points.reserve(npoints);
-
-          for (size_t i = 0; i < npoints; i++) {
-            // uniformly generate coordinates for each of n points
-            points.push_back(
-                dvec3(u(gen) + cell.x, u(gen) + cell.y, u(gen) + cell.z));
-          }
-        }
+      // the closest points are guaranteed to be in the 3x3x3 block of cells around x,y,z
+      for (size_t dz = 0; dz < 3; dz++) {
+        for (size_t dy = 0; dy < 3; dy++) {
+          for (size_t dx = 0; dx < 3; dx++) {
+            ivec3 cell(xcells[x] + (long long)dx - 1, ycells[y] + (long long)dy - 1, 0);
+            dvec3 corner = ltc.corner_of(cell);
+            corner.z = zcorners[dz];
 
-        calc_dists<N>(distf, dists, center, cache[cell]);
-      };
-
-      double zto = cell.z + cellsize;
-      double yto = cell.y + cellsize;
-      double xto = cell.x + cellsize;
-      for (double cz = cell.z - cellsize; cz <= zto; cz += cellsize) {
-        for (double cy = cell.y - cellsize; cy <= yto; cy += cellsize) {
-          for (double cx = cell.x - cellsize; cx <= xto; cx += cellsize) {
-            dvec3 corner(cx, cy, cz);
-            test_point(corner);
+            points_t const& points = slabs[dz][yoffsets[dy] + xoffsets[x][dx]];
+            calc_dists<N>(distf, dists, center, corner, points);
           }
         }
       }
-      /*
-      // go to the top left
-      cell.x -= cellsize;
-      cell.y -= cellsize;
-
-      test_point(cell);
-      cell.x += cellsize;
-      test_point(cell);
-      cell.x += cellsize;
-      test_point(cell);
-
-      // middle-left
-      cell.x -= cellsize*2;
-      cell.y += cellsize;
-
-      test_point(cell);
-      cell.x += cellsize;
-      test_point(cell);
-      cell.x += cellsize;
-      test_point(cell);
-
-      // bottom-left
-      cell.x -= cellsize*2;
-      cell.y += cellsize;
-
-      test_point(cell);
-      cell.x += cellsize;
-      test_point(cell);
-      cell.x += cellsize;
-      test_point(cell);
-      */
 
       auto& vals = dists.get_values();
-      constexpr_for<0, N, 1>([&](auto i) { values[idx * N + i] = vals[i]; });
+      constexpr_for<0, N, 1>([&](auto i) { values[idx * N + i] = larray_cast<T>(vals[i]); });
     }
   }
 }
 
-template <size_t N>
-Worley::result_t Worley::compute_frame(cache_t& cache, double z) const {
+template <size_t N, typename Cache>
+Worley::result_t Worley::compute_frame(Cache& cache, double z) const {
   result_t values(get_result_size());
 
   compute_frame<N>(cache, z, values.data());
@@ -194,54 +227,72 @@ std::string Worley::to_string() const {
     W.field = (ENUM)val;                                                       \
     lua_pop(L, 1);                                                             \
   }
-int Worley::lnew(lua_State* L) {
-  Worley W; // start off default initialized, fill in as we go
-  W.seed = std::random_device()(); // default init seed if there in case none is
-                                   // given
+void Worley::load_options(lua_State* L, int idx) {
+  Worley& W = *this;
 
-  int idx = 1;
+  GET_NUMBER(idx, width, width);
+  GET_NUMBER(idx, height, height);
+  GET_INTEGER(idx, length, length);
 
-  if (lua_istable(L, idx)) {
-    GET_NUMBER(idx, width, width);
-    GET_NUMBER(idx, height, height);
-    GET_INTEGER(idx, length, length);
+  GET_NUMBER(idx, mean_points, mean_points);
+  GET_INTEGER(idx, n, n);
+  GET_NUMBER(idx, cellsize, cellsize);
+  GET_ENUM(idx, DISTANCE_FUNC, DISTANCE_LAST, distance_func, distance_func);
 
-    GET_NUMBER(idx, mean_points, mean_points);
-    GET_INTEGER(idx, n, n);
-    GET_NUMBER(idx, cellsize, cellsize);
-    GET_ENUM(idx, DISTANCE_FUNC, DISTANCE_LAST, distance_func, distance_func);
+  GET_NUMBER(idx, movement, movement);
+  GET_ENUM(idx, INTERPOLATE_FUNC, INTERPOLATE_LAST, movement_func,
+           movement_func);
 
-    GET_NUMBER(idx, movement, movement);
-    GET_ENUM(idx, INTERPOLATE_FUNC, INTERPOLATE_LAST, movement_func,
-             movement_func);
+  GET_INTEGER(idx, seed, seed);
+  GET_ENUM(idx, ARRAY_TYPE, ARRAY_TYPE_LAST, array_type, array_type);
 
-    GET_INTEGER(idx, seed, seed);
+  // get "loops" of form { x, y, z }
+  if (lua_getfield(L, idx, "loops") != LUA_TNIL) {
+    luaL_argexpected(L, lua_istable(L, -1), idx, "expected table of form {x,y,z}");
 
-    // get "loops" of form { x, y, z }
-    if (lua_getfield(L, idx, "loops")) {
-      bool is_table = lua_istable(L, -1);
-      luaL_argexpected(L, is_table, idx, "expected table of form {x,y,z}");
+    GET_NUMBER(-1, freq.x, x);
+    GET_NUMBER(-1, freq.y, y);
+    GET_NUMBER(-1, freq.z, z);
+  }
+  lua_pop(L, 1);
+}
 
-      // make sure we were given a table !!
-      if (!is_table)
-        return 0;
+int Worley::lnew(lua_State* L) {
+  Worley W; // start off default initialized, fill in as we go
+  W.seed = std::random_device()(); // default init seed if there in case none is
+                                   // given
 
-      GET_NUMBER(-1, freq.x, x);
-      GET_NUMBER(-1, freq.y, y);
-      GET_NUMBER(-1, freq.z, z);
+  int idx = 1;
 
-      lua_pop(L, 1);
-    }
+  if (lua_istable(L, idx)) {
+    W.load_options(L, idx);
   } else if (lua_gettop(L) > 0) {
     luaL_error(L, "invalid argument passed to Worley constructor");
   }
 
-  // copy our constructed Worley object into a userdata
-  push_new<Worley>(L, W);
+  // move our constructed Worley object into a userdata
+  push_new<Worley>(L, std::move(W));
 
   // return Worley userdata object
   return 1;
 }
+
+int Worley::set(lua_State* L) {
+  Worley* worley = get_obj<Worley>(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  worley->load_options(L, 2);
+
+  // return W, so that calls can be chained, e.g., W:set{ n = 2 }:compute()
+  lua_pushvalue(L, 1);
+  return 1;
+}
+
+int Worley::gc(lua_State* L) {
+  // releases the cached cells
+  get_obj<Worley>(L, 1)->~Worley();
+  return 0;
+}
 #undef GET_ENUM
 #undef GET_INTEGER
 #undef GET_NUMBER
@@ -252,62 +303,116 @@ int Worley::lnew(lua_State* L) {
     break;                                                                     \
   }
 
+int Worley::compute_frames(lua_State* L, Worley* worley, int into) {
+  erp_func_t mfun = interpolate_funcs[worley->movement_func];
+
+  size_t size = worley->get_result_size();
+
+  auto compute_all = [&](auto& cache) {
+    double z = 0.0;
+    double t = 0.0;
+    double t_inc = 1.0 / (double)worley->length;
+    for (double frame = 0; frame < worley->length; frame++) {
+      // reuse whatever is already at frames[frame+1] if it fits
+      lua_geti(L, into, frame + 1);
+
+      int pushed = visit_array_type(worley->array_type, [&](auto tag) {
+        typedef typename decltype(tag)::type T;
+
+        auto arr = larray<T>::push_or_reuse(L, -1, size);
+
+        // compute directly on top of the larray values
+        switch (worley->n) {
+          // TODO: if WORLEY_MAX_N is ever set > 9, then macro_utils will need to
+          // be expanded to actually account for more "recursion"
+          EVAL(REPEAT(WORLEY_MAX_N, NTH_CASE, ~))
+        default:
+          std::string err =
+              std::string("unsupported Worley `n` given, 0 < n <= ") +
+              std::to_string(WORLEY_MAX_N);
+          luaL_error(L, err.c_str());
+          return 0;
+        }
+
+        return 1;
+      });
+
+      if (!pushed)
+        return 0;
+
+      // frames[frame+1] = arr
+      lua_seti(L, into, frame + 1);
+      lua_pop(L, 1);
+
+      // move further in
+      t += t_inc;
+      z = mfun(0.0, worley->movement, t);
+    }
+
+    worley->cache_stats = cache.get_stats();
+
+    lua_pushvalue(L, into);
+
+    // return larray[]
+    return 1;
+  };
+
+  // cache to be used to avoid constantly recalculating Poisson + points, even
+  // though the calcs. are repeatable given the same location+seed, it is heavy.
+  // A lattice that loops everywhere only has so many distinct cells, which are
+  // then all generated once and shared by every frame. Either is kept on the
+  // object, so computing again with e.g. a different n reuses the same cells
+  worley->validate_cache();
+
+  lattice3 ltc = worley->get_lattice();
+  if (is_periodic(ltc)) {
+    if (!worley->periodic_cell_cache)
+      worley->periodic_cell_cache =
+          std::make_unique<periodic_cache_t>(make_periodic_cache(ltc, worley->mean_points));
+    return compute_all(*worley->periodic_cell_cache);
+  }
+
+  if (!worley->cell_cache)
+    worley->cell_cache = std::make_unique<cache_t>(
+        make_cache(ltc, worley->width, worley->height, worley->mean_points));
+  return compute_all(*worley->cell_cache);
+}
+
 int Worley::compute(lua_State* L) {
   Worley* worley = get_obj<Worley>(L, 1);
 
   lua_createtable(L, worley->length, 0);
 
-  erp_func_t mfun = interpolate_funcs[worley->movement_func];
+  return compute_frames(L, worley, lua_gettop(L));
+}
 
-  // cache to be used to avoid constantly recalculating Poisson + points, even
-  // though the calcs. are repeatable given the same location+seed, it is heavy
-  cache_t cache;
-
-  double z = 0.0;
-  double t = 0.0;
-  double t_inc = 1.0 / (double)worley->length;
-  for (double frame = 0; frame < worley->length; frame++) {
-    lua_getglobal(L, "ldarray");
-
-    int size = worley->get_result_size();
-
-    // add ldarray size argument to stack
-    lua_pushinteger(L, size);
-
-    // call ldarray constructor
-    if (lua_pcall(L, 1, 1, 0) != LUA_OK)
-      return 0;
-
-    auto arr = get_obj<larray<double>>(L, -1);
-
-    // sanity check
-    LASSERT(arr->size == worley->get_result_size(),
-            "unexpected error, array size differs from Worley");
-
-    // compute directly on top of the ldarray values
-    switch (worley->n) {
-      // TODO: if WORLEY_MAX_N is ever set > 9, then macro_utils will need to be
-      // expanded to actually account for more "recursion"
-      EVAL(REPEAT(WORLEY_MAX_N, NTH_CASE, ~))
-    default:
-      std::string err = std::string("unsupported Worley `n` given, 0 < n <= ") +
-                        std::to_string(WORLEY_MAX_N);
-      luaL_error(L, err.c_str());
-      return 0;
-    }
+int Worley::compute_into(lua_State* L) {
+  Worley* worley = get_obj<Worley>(L, 1);
+  luaL_checktype(L, 2, LUA_TTABLE);
 
-    // frames[frame+1] = arr
-    lua_seti(L, -2, frame + 1);
+  return compute_frames(L, worley, 2);
+}
+#undef N_CASE
 
-    // move further in
-    t += t_inc;
-    z = mfun(0.0, worley->movement, t);
-  }
+int Worley::get_cache_stats(lua_State* L) {
+  Worley* worley = get_obj<Worley>(L, 1);
+  lattice_stats const& stats = worley->cache_stats;
+
+  lua_createtable(L, 0, 5);
+
+#define SET_STAT(key)                                                          \
+  lua_pushinteger(L, stats.key);                                               \
+  lua_setfield(L, -2, #key);
+
+  SET_STAT(generated);
+  SET_STAT(evicted);
+  SET_STAT(recycled);
+  SET_STAT(peak_slabs);
+  SET_STAT(peak_cells);
+#undef SET_STAT
 
-  // return ldarray[]
   return 1;
 }
-#undef N_CASE
 
 int Worley::to_string(lua_State* L) {
   Worley* worley = get_obj<Worley>(L, 1);
@@ -320,6 +425,10 @@ int Worley::to_string(lua_State* L) {
 
 void Worley::register_class(lua_State* L) {
   static const luaL_Reg methods[] = {{"compute", Worley::compute},
+                                     {"compute_into", Worley::compute_into},
+                                     {"cache_stats", Worley::get_cache_stats},
+                                     {"set", Worley::set},
+                                     {"__gc", Worley::gc},
                                      {"__tostring", Worley::to_string},
                                      {nullptr, nullptr}};
 
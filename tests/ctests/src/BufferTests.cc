@@ -1,8 +1,139 @@
 #include "ibuffer.h"
 
 #include <assert.h>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
 
 int main(int argc, char** argv) {
     ibuffer<int, 4> buffer(192, 192, int4{0});
+
+    // odd sizes, so that the planar rows need padding
+    fbuffer4 interleaved(37, 23, float4(0.0f));
+    for (size_t y = 0; y < interleaved.get_height(); y++) {
+        for (size_t x = 0; x < interleaved.get_width(); x++) {
+            interleaved.set(x, y, float4(x, y, x * y, x + y));
+        }
+    }
+
+    pfbuffer4 planar = interleaved.to_planar();
+    assert(planar.get_width() == 37 && planar.get_height() == 23);
+    assert(planar.get_stride() >= 37 && planar.get_stride() % 16 == 0);
+
+    // every plane and row starts on an aligned address
+    for (size_t c = 0; c < 4; c++) {
+        assert((uintptr_t)planar.plane(c) % pfbuffer4::alignment == 0);
+        for (size_t y = 0; y < planar.get_height(); y++)
+            assert((uintptr_t)planar.row(c, y) % pfbuffer4::alignment == 0);
+    }
+
+    for (size_t y = 0; y < interleaved.get_height(); y++) {
+        for (size_t x = 0; x < interleaved.get_width(); x++) {
+            float4 expected = interleaved.cget(x, y);
+            float4 actual = planar.cget(x, y);
+            for (size_t c = 0; c < 4; c++) {
+                assert(expected[c] == actual[c]);
+                assert(planar.row(c, y)[x] == expected[c]);
+            }
+        }
+    }
+
+    // sampling goes through the same code paths in both layouts
+    for (float y = -1.5f; y < 24.0f; y += 0.75f) {
+        for (float x = -1.5f; x < 38.0f; x += 0.75f) {
+            float4 a = interleaved.get_bilinear_def(x, y);
+            float4 b = planar.get_bilinear_def(x, y);
+            float4 c = interleaved.get_bilinear_clamp(x, y);
+            float4 d = planar.get_bilinear_clamp(x, y);
+            for (size_t i = 0; i < 4; i++) {
+                assert(a[i] == b[i]);
+                assert(c[i] == d[i]);
+            }
+        }
+    }
+
+    // both array conversions keep the interleaved order
+    std::vector<float> arr = interleaved.to_arr();
+    assert(planar.to_arr() == arr);
+
+    pfbuffer4 from_arr(37, 23, float4(0.0f));
+    from_arr.set_from(arr);
+    assert(from_arr.to_arr() == arr);
+
+    fbuffer4 back = planar.to_interleaved();
+    assert(back.to_arr() == arr);
+
+    pfbuffer4 converted(interleaved);
+    assert(converted.to_arr() == arr);
+
+    // wrap modes, including negative coordinates and coordinates more than a period away
+    fbuffer1 line(5, 1, fbuffer1::pixel(-1.0f));
+    for (size_t x = 0; x < 5; x++)
+        line.set(x, 0, fbuffer1::pixel(x));
+
+    const long long xs[] = {-7, -6, -5, -4, -1, 0, 3, 4, 5, 8, 9, 13};
+    const float loop[] = {3, 4, 0, 1, 4, 0, 3, 4, 0, 3, 4, 3};
+    const float clamp[] = {0, 0, 0, 0, 0, 0, 3, 4, 4, 4, 4, 4};
+    const float mirror[] = {1, 2, 3, 4, 1, 0, 3, 4, 3, 0, 1, 3};
+    const float def[] = {-1, -1, -1, -1, -1, 0, 3, 4, -1, -1, -1, -1};
+    for (size_t i = 0; i < std::size(xs); i++) {
+        assert(line.get_or_loop(xs[i], 0)[0] == loop[i]);
+        assert(line.get_or_clamp(xs[i], 0)[0] == clamp[i]);
+        assert(line.get_or_mirror(xs[i], 0)[0] == mirror[i]);
+        assert(line.get_or_def(xs[i], 0)[0] == def[i]);
+    }
+
+    fbuffer1 single(1, 1, fbuffer1::pixel(0.0f));
+    single.set(0, 0, fbuffer1::pixel(7.0f));
+    assert(single.get_or_mirror(-3, 5)[0] == 7.0f);
+    assert(single.get_or_loop(-3, 5)[0] == 7.0f);
+
+    // nearest sampling rounds to the closest pixel center
+    assert((interleaved.sample<wrap_def>(2.4f, 3.6f)[0] == 2.0f));
+    assert((interleaved.sample<wrap_def>(2.6f, 3.6f)[1] == 4.0f));
+    assert((planar.sample<wrap_clamp>(-3.0f, 40.0f)[1] == 22.0f));
+
+    // blocks cover every pixel of the region exactly once, and only interior blocks stay reach
+    // pixels away from the border
+    for (size_t reach : {0, 2, 9, 30}) {
+        std::vector<int> visits(37 * 23, 0);
+        interleaved.for_each_block<wrap_clamp>(
+            1, 2, 36, 23, reach, [&](auto wrap, size_t x0, size_t y0, size_t x1, size_t y1) {
+                bool interior = std::is_same_v<decltype(wrap), wrap_interior>;
+                assert(x0 < x1 && y0 < y1);
+                if (interior)
+                    assert(x0 >= reach && y0 >= reach && x1 + reach <= 37 && y1 + reach <= 23);
+                for (size_t y = y0; y < y1; y++)
+                    for (size_t x = x0; x < x1; x++)
+                        visits[y * 37 + x]++;
+            });
+
+        for (size_t y = 0; y < 23; y++)
+            for (size_t x = 0; x < 37; x++)
+                assert(visits[y * 37 + x] == (x >= 1 && x < 36 && y >= 2 ? 1 : 0));
+    }
+
+    // parallel apply/map give the same result as the serial ones
+    thread_pool pool(3);
+    fbuffer4 serial(interleaved);
+    fbuffer4 parallel(interleaved);
+    serial.apply([](auto p) { return p * 2.0f + 1.0f; });
+    parallel.apply_par([](auto p) { return p * 2.0f + 1.0f; }, pool);
+    assert(serial.to_arr() == parallel.to_arr());
+
+    auto sum = [](auto p) { return fbuffer1::pixel(p.sum()); };
+    assert((interleaved.map<float, 1>(sum).to_arr() ==
+            interleaved.map_par<float, 1>(sum, pool).to_arr()));
+
+    // fewer rows than bands
+    fbuffer4 small(5, 2, float4(0.0f));
+    small.fill(1.0f);
+    small.apply_par([](auto p) { return p + 1.0f; }, pool);
+    assert(small.to_arr() == std::vector<float>(5 * 2 * 4, 2.0f));
+
+    std::cout << "planar stride: " << planar.get_stride() << std::endl;
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,96 @@
+#include "gradient_noise.h"
+
+#include <assert.h>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+int main(int argc, char** argv) {
+    // odd count, so that every kernel also goes through its padded tail
+    const size_t n = 1003;
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> u(-300.0f, 300.0f);
+
+    std::vector<float> x(n), y(n), z(n);
+    for (size_t i = 0; i < n; i++) {
+        x[i] = u(gen);
+        y[i] = u(gen);
+        z[i] = u(gen);
+    }
+
+    // a few exact corners and points just around them, including negative ones
+    const float edges[] = {0.0f, -1.0f, 3.0f, -0.0001f, 0.9999f, -7.5f};
+    for (size_t i = 0; i < std::size(edges); i++) {
+        x[i] = edges[i];
+        y[i] = edges[(i + 1) % std::size(edges)];
+        z[i] = edges[(i + 2) % std::size(edges)];
+    }
+
+    std::vector<float> ref2(n), ref3(n);
+    gradient_noise2(KERNEL_SCALAR, 1234, x.data(), y.data(), ref2.data(), n);
+    gradient_noise3(KERNEL_SCALAR, 1234, x.data(), y.data(), z.data(), ref3.data(), n);
+
+    for (size_t i = 0; i < n; i++) {
+        assert(std::fabs(ref2[i]) <= 1.5f && std::fabs(ref3[i]) <= 1.5f);
+    }
+
+    // noise is 0 on every corner
+    float corner[] = {-3.0f, 5.0f, 12.0f};
+    float out = 1.0f;
+    gradient_noise2(KERNEL_SCALAR, 99, corner, corner + 1, &out, 1);
+    assert(out == 0.0f);
+    gradient_noise3(KERNEL_SCALAR, 99, corner, corner + 1, corner + 2, &out, 1);
+    assert(out == 0.0f);
+
+    // other seeds give other noise
+    std::vector<float> other(n);
+    gradient_noise2(KERNEL_SCALAR, 1235, x.data(), y.data(), other.data(), n);
+    assert(other != ref2);
+
+    // every supported kernel matches the scalar reference, up to fused multiply-adds
+    assert(gradient_kernel_supported(KERNEL_SCALAR));
+    assert(gradient_kernel_supported(best_gradient_kernel()));
+
+    for (size_t k = KERNEL_SCALAR; k < GRADIENT_KERNEL_LAST; k++) {
+        GRADIENT_KERNEL kernel = (GRADIENT_KERNEL)k;
+        if (!gradient_kernel_supported(kernel)) {
+            std::cout << GRADIENT_KERNEL_NAMES[k] << ": not supported" << std::endl;
+            continue;
+        }
+
+        for (size_t count : {n, (size_t)1, (size_t)7, (size_t)9}) {
+            std::vector<float> out2(count), out3(count);
+            gradient_noise2(kernel, 1234, x.data(), y.data(), out2.data(), count);
+            gradient_noise3(kernel, 1234, x.data(), y.data(), z.data(), out3.data(), count);
+
+            for (size_t i = 0; i < count; i++) {
+                assert(std::fabs(out2[i] - ref2[i]) <= 1e-5f);
+                assert(std::fabs(out3[i] - ref3[i]) <= 1e-5f);
+            }
+        }
+
+        std::cout << GRADIENT_KERNEL_NAMES[k] << ": matches scalar" << std::endl;
+    }
+
+    // gradient tables are unit gradients, built once
+    for (size_t dims : {2, 3}) {
+        std::vector<double> const& table = gradient_table(dims);
+        assert(table.size() == GRADIENT_TABLE_SIZE * dims);
+        assert(&table == &gradient_table(dims));
+
+        for (size_t i = 0; i < table.size(); i += dims) {
+            double len2 = 0;
+            for (size_t d = 0; d < dims; d++)
+                len2 += table[i + d] * table[i + d];
+            assert(std::fabs(len2 - 1) < 1e-9);
+        }
+    }
+
+    std::cout << "best kernel: " << GRADIENT_KERNEL_NAMES[best_gradient_kernel()] << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "larray.h"
+
+#include <assert.h>
+#include <iostream>
+#include <new>
+#include <vector>
+
+// larrays are normally allocated as Lua userdata, with the values trailing the struct
+template <typename T> static larray<T>* make_larray(std::vector<char>& storage, size_t size) {
+  storage.resize(sizeof(larray<T>) + (size - 1) * sizeof(T));
+  return new (storage.data()) larray<T>(size);
+}
+
+int main(int argc, char** argv) {
+  // integer types round and saturate
+  assert(larray_cast<uint8_t>(127.4) == 127);
+  assert(larray_cast<uint8_t>(127.6) == 128);
+  assert(larray_cast<uint8_t>(-3.0) == 0);
+  assert(larray_cast<uint8_t>(300.0) == 255);
+  assert(larray_cast<uint16_t>(70000.0f) == 65535);
+  assert(larray_cast<uint32_t>(1e12) == 4294967295u);
+  assert(larray_cast<uint8_t>(std::numeric_limits<double>::quiet_NaN()) == 0);
+  assert(larray_cast<uint8_t>(200) == 200);
+  assert(larray_cast<uint8_t>(-5) == 0);
+  assert(larray_cast<uint8_t>((uint16_t)300) == 255);
+  assert(larray_cast<uint16_t>((uint32_t)70000) == 65535);
+  assert(larray_cast<uint32_t>((uint8_t)7) == 7);
+
+  // floating types are plain conversions
+  assert(larray_cast<float>(0.5) == 0.5f);
+  assert(larray_cast<double>(-2.25f) == -2.25);
+
+  std::vector<double> colors = {0.0, 12.5, 255.0, 256.0, -1.0, 99.49};
+
+  std::vector<char> bstorage;
+  larray<uint8_t>* barr = make_larray<uint8_t>(bstorage, colors.size());
+  barr->from(colors);
+
+  uint8_t expected[] = {0, 13, 255, 255, 0, 99};
+  for (size_t i = 0; i < colors.size(); i++) {
+    std::cout << (int)barr->values[i] << " ";
+    assert(barr->values[i] == expected[i]);
+  }
+  std::cout << std::endl;
+
+  std::vector<char> fstorage;
+  larray<float>* farr = make_larray<float>(fstorage, colors.size());
+  farr->from(colors);
+  for (size_t i = 0; i < colors.size(); i++)
+    assert(farr->values[i] == (float)colors[i]);
+
+  // copies between integer arrays saturate like set does, rather than wrapping around
+  std::vector<char> wstorage;
+  larray<uint16_t>* warr = make_larray<uint16_t>(wstorage, 3);
+  warr->from(std::vector<double>{300.0, -5.0, 42.0});
+
+  std::vector<char> cstorage;
+  larray<uint8_t>* carr = make_larray<uint8_t>(cstorage, 4);
+  carr->from(std::vector<double>{1.0, 1.0, 1.0, 1.0});
+  carr->from(*warr, 1);
+  assert(carr->values[0] == 1);
+  assert(carr->values[1] == 255);
+  assert(carr->values[2] == 0);
+  assert(carr->values[3] == 42);
+
+  // to_bytes clamps out of range integer values instead of keeping their low byte
+  char bytes[3];
+  warr->pack_bytes(bytes);
+  assert((uint8_t)bytes[0] == 255 && (uint8_t)bytes[1] == 0 && (uint8_t)bytes[2] == 42);
+
+  std::vector<char> ustorage;
+  larray<uint32_t>* uarr = make_larray<uint32_t>(ustorage, 3);
+  uarr->from(std::vector<double>{256.0, 255.0, 4294967295.0});
+  uarr->pack_bytes(bytes);
+  assert((uint8_t)bytes[0] == 255 && (uint8_t)bytes[1] == 255 && (uint8_t)bytes[2] == 255);
+  uarr->pack_bytes(bytes, 0.5);
+  assert((uint8_t)bytes[0] == 128 && (uint8_t)bytes[1] == 128 && (uint8_t)bytes[2] == 255);
+
+  // the type tags resolve to the expected element types
+  auto element_size = [](auto tag) { return sizeof(typename decltype(tag)::type); };
+  assert(visit_array_type(ARRAY_U8, element_size) == 1);
+  assert(visit_array_type(ARRAY_U16, element_size) == 2);
+  assert(visit_array_type(ARRAY_U32, element_size) == 4);
+  assert(visit_array_type(ARRAY_FLOAT, element_size) == 4);
+  assert(visit_array_type(ARRAY_DOUBLE, element_size) == 8);
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "lattice.h"
+#include "lattice3.h"
+
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// stand-in for e.g. Worley points, unique per cell
+struct encode_cell {
+  long long operator()(lattice_cell<3> const& c) const { return c[0] * 10000 + c[1] * 100 + c[2]; }
+};
+
+int main(int argc, char** argv) {
+  // integer cells agree with the double corners, for whole and fractional cell sizes
+  for (double cs : {1.0, 3.0, 16.0, 7.3, 0.7}) {
+    lattice3 ltc(cs, dvec3(0));
+
+    for (double v = -40.0; v < 40.0; v += 0.5) {
+      ivec3 cell = ltc.cell_of(v, -v, v * 2);
+      dvec3 corner = ltc.get_corner(v, -v, v * 2);
+      assert(ltc.corner_of(cell) == corner);
+    }
+
+    // stepping along a scanline gives exactly what cell_of does
+    std::vector<long long> cells(200);
+    ltc.cells_along(-37.0, cells.size(), cells.data());
+    for (size_t i = 0; i < cells.size(); i++)
+      assert(cells[i] == ltc.cell_of(-37.0 + i));
+  }
+
+  // cells a whole period apart share a seed, and wrap to the same representative
+  lattice3 looping(16.0, dvec3(4, 3, 0));
+  looping.set_seed(1234);
+  assert(looping.cell_seed(ivec3(-1, 0, 2)) == looping.cell_seed(ivec3(3, 3, 2)));
+  assert(looping.cell_seed(ivec3(9, -7, 5)) == looping.cell_seed(ivec3(1, 2, 5)));
+  assert(looping.cell_rep(ivec3(-5, 7, -9)) == ivec3(3, 1, -9));
+  assert(looping.cell_seed(ivec3(0, 0, 0)) != looping.cell_seed(ivec3(0, 0, 1)));
+
+  // fractional frequencies are rounded to whole cells
+  lattice3 fractional(16.0, dvec3(3.4, 0, 0));
+  assert(fractional.cell_rep(ivec3(3, 0, 0)) == ivec3(0, 0, 0));
+
+  // seeds differ between neighbouring cells and between lattice seeds
+  lattice3 a(16.0, dvec3(0)), b(16.0, dvec3(0));
+  a.set_seed(1);
+  b.set_seed(2);
+  size_t collisions = 0;
+  for (long long x = -8; x < 8; x++) {
+    for (long long y = -8; y < 8; y++) {
+      collisions += a.cell_seed(ivec3(x, y, 0)) == a.cell_seed(ivec3(x + 1, y, 0));
+      collisions += a.cell_seed(ivec3(x, y, 0)) == a.cell_seed(ivec3(x, y + 1, 0));
+      collisions += a.cell_seed(ivec3(x, y, 0)) == b.cell_seed(ivec3(x, y, 0));
+    }
+  }
+  assert(collisions == 0);
+
+  // generic lattices store exactly what the generator gives for every cell of a slab
+  lattice<3, long long, encode_cell> cells({-2, -1, 0}, {3, 4, 0});
+  assert(cells.empty());
+
+  cells.prefetch(5, 7);
+  assert(cells.slab_count() == 3 && cells.size() == 3 * 6 * 6);
+  for (long long z = 5; z <= 7; z++)
+    for (long long y = -1; y <= 4; y++)
+      for (long long x = -2; x <= 3; x++)
+        assert(cells.get({x, y, z}) == x * 10000 + y * 100 + z);
+
+  // growing in either direction keeps what is there, slabs stay contiguous
+  cells.prefetch(3, 4);
+  cells.prefetch(6, 9);
+  assert(cells.first_slab() == 3 && cells.last_slab() == 9);
+  assert(cells.at({1, 1, 10}) == 10110 && cells.last_slab() == 10);
+
+  cells.retain(6, 8);
+  assert(cells.first_slab() == 6 && cells.last_slab() == 8 && !cells.has_slab(5));
+  assert(cells.get({3, 4, 6}) == 30406);
+
+  bool thrown = false;
+  try {
+    cells.get({0, 0, 2});
+  } catch (std::out_of_range const&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  thrown = false;
+  try {
+    cells.get({4, 0, 6});
+  } catch (std::out_of_range const&) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // a far away range replaces the stored one instead of filling the gap
+  cells.prefetch(-50, -49);
+  assert(cells.first_slab() == -50 && cells.slab_count() == 2);
+  assert(cells.get({-2, -1, -49}) == -20149);
+
+  cells.retain(0, 1);
+  assert(cells.empty());
+
+  // 2D lattices store rows of x along y
+  auto sum = [](lattice_cell<2> const& c) { return c[0] + c[1]; };
+  lattice<2, long long, decltype(sum)> plane({0, 0}, {9, 0}, sum);
+  assert(plane.at({7, 3}) == 10 && plane.at({9, 2}) == 11 && plane.slab_count() == 2);
+
+  // moving along z keeps only the window around the current position, with evicted slabs recycled
+  lattice<3, long long, encode_cell> moving({0, 0, 0}, {7, 7, 0});
+  for (long long z = 0; z < 50; z++) {
+    moving.advance(z - 1, z + 1);
+    assert(moving.slab_count() == 3 && moving.get({7, 7, z + 1}) == 70700 + z + 1);
+  }
+  lattice_stats stats = moving.get_stats();
+  assert(stats.peak_slabs == 3 && stats.peak_cells == 3 * 8 * 8);
+  assert(stats.generated == 52 && stats.evicted == 49 && stats.recycled == 49);
+
+  // periodic lattices generate each distinct cell exactly once, up front
+  periodic_lattice<3, long long, encode_cell> periodic({4, 3, 2});
+  assert(periodic.size() == 4 * 3 * 2);
+  assert(periodic.get({0, 0, 0}) == 0 && periodic.get({3, 2, 1}) == 30201);
+  assert(periodic.get({-1, -1, -1}) == 30201 && periodic.get({9, 7, 4}) == 10100);
+  assert(periodic.slab_data(3) == periodic.slab_data(1));
+  assert(periodic.slab_data(1)[periodic.axis_offset(0, 5) + periodic.axis_offset(1, -2)] == 10101);
+
+  std::cout << "seed of (0,0,0): " << a.cell_seed(ivec3(0, 0, 0)) << std::endl;
+
+  return 0;
+}
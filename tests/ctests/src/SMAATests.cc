@@ -0,0 +1,134 @@
+#include "smaa.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cstdlib>
+#include <iostream>
+
+// a few frames of a pixel-art style animation, a long diagonal-ish bar that slides to the right
+// over a static background, a staircase with a moving step and a small blinking square
+static std::vector<fbuffer4> make_animation(size_t width, size_t height, size_t frames) {
+  std::vector<fbuffer4> animation;
+
+  for (size_t f = 0; f < frames; f++) {
+    fbuffer4 frame(width, height, float4(0.0f));
+
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x++) {
+        float4 color(20.0f, 30.0f, 90.0f, 255.0f);
+
+        // static background stripes, so that there are edges which never change
+        if ((x / 24) % 2 == 0 && y > height / 2)
+          color = float4(200.0f, 200.0f, 200.0f, 255.0f);
+
+        // long shallow bar, long enough to exceed the maximum search length
+        long long bx = (long long)x - (long long)(f * 3);
+        if (bx >= 0 && bx < 100 && y >= 10 + (size_t)bx / 12 && y < 16 + (size_t)bx / 12)
+          color = float4(250.0f, 180.0f, 20.0f, 255.0f);
+
+        // shallow staircase where only one step is moved each frame, the weights along the
+        // neighbouring steps still change since they depend on the length of the whole line
+        size_t step = x < 40 + f * 2 ? x / 40 : x / 40 + 1;
+        if (y >= 60 + step && y < 80)
+          color = float4(90.0f, 250.0f, 120.0f, 255.0f);
+
+        if (f % 2 == 0 && x >= width - 6 && y < 6)
+          color = float4(255.0f, 0.0f, 0.0f, 255.0f);
+
+        frame.set(x, y, color);
+      }
+    }
+
+    animation.push_back(frame);
+  }
+
+  return animation;
+}
+
+static int compare(ibuffer4& expected, ibuffer4& actual) {
+  int mismatched = 0;
+  for (size_t i = 0; i < expected.get_length(); i++) {
+    for (size_t c = 0; c < 4; c++) {
+      if (expected.get(i)[c] != actual.get(i)[c]) {
+        mismatched++;
+        break;
+      }
+    }
+  }
+  return mismatched;
+}
+
+static int max_difference(ibuffer4& expected, ibuffer4& actual) {
+  int diff = 0;
+  for (size_t i = 0; i < expected.get_length(); i++) {
+    for (size_t c = 0; c < 4; c++) {
+      diff = std::max(diff, std::abs(expected.get(i)[c] - actual.get(i)[c]));
+    }
+  }
+  return diff;
+}
+
+int main(int argc, char** argv) {
+  int failures = 0;
+
+  auto animation = make_animation(160, 96, 6);
+
+  for (EDGE_DETECTION mode : {COLOR_EDGES, LUMA_EDGES}) {
+    SMAA smaa(mode);
+
+    auto incremental = smaa.apply_animation(animation);
+    assert(incremental.size() == animation.size());
+
+    for (size_t f = 0; f < animation.size(); f++) {
+      ibuffer4 full = smaa.apply(animation[f]);
+
+      int mismatched = compare(full, incremental[f]);
+      std::cout << EDGE_DETECTION_NAMES[mode] << " frame " << f << ": " << mismatched
+                << " mismatched pixels" << std::endl;
+
+      assert(mismatched == 0);
+      failures += mismatched != 0;
+    }
+  }
+
+  // tiles of every size, including ones smaller than the halo and ones that don't divide the image,
+  // should give back exactly what the untiled passes do
+  for (EDGE_DETECTION mode : {COLOR_EDGES, LUMA_EDGES}) {
+    SMAA untiled(mode);
+    untiled.set_tile_size(0);
+    ibuffer4 expected = untiled.apply(animation[1]);
+
+    for (size_t tile : {8, 37, 64, 100}) {
+      SMAA tiled(mode);
+      tiled.set_tile_size(tile);
+      ibuffer4 actual = tiled.apply(animation[1]);
+
+      int mismatched = compare(expected, actual);
+      std::cout << EDGE_DETECTION_NAMES[mode] << " tile " << tile << ": " << mismatched
+                << " mismatched pixels" << std::endl;
+
+      assert(mismatched == 0);
+      failures += mismatched != 0;
+    }
+  }
+
+  // the packed 8-bit lookup textures should only ever be off from the float ones by rounding
+  for (EDGE_DETECTION mode : {COLOR_EDGES, LUMA_EDGES}) {
+    SMAA packed(mode, LOOKUP_U8);
+    SMAA reference(mode, LOOKUP_FLOAT);
+
+    for (size_t f = 0; f < animation.size(); f++) {
+      ibuffer4 expected = reference.apply(animation[f]);
+      ibuffer4 actual = packed.apply(animation[f]);
+
+      int diff = max_difference(expected, actual);
+      std::cout << EDGE_DETECTION_NAMES[mode] << " frame " << f << ": " << diff
+                << " max difference between lookup precisions" << std::endl;
+
+      assert(diff <= 1);
+      failures += diff > 1;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "base_noise.h"
+
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// a row of width pixels past the end of a loop has to match the start of it
+static double seam(lattice3 const& ltc, bool threed, size_t width, double y, double z,
+                   double yjump, double zjump) {
+    simplex_octave noise(ltc, width, threed);
+
+    std::vector<double> a(width), b(width);
+    noise.row(y, z, a.data());
+    noise.row(y + yjump, z + zjump, b.data());
+
+    double worst = 0;
+    for (size_t x = 0; x < width; x++) {
+        assert(std::fabs(a[x]) <= 1.1);
+        worst = std::max(worst, std::fabs(a[x] - b[x]));
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    const double cs = 12.5;
+
+    // odd loops along y stretch the 2D lattice by a row, along x and z they fit as they are
+    for (int loopy : {4, 5}) {
+        lattice3 ltc(cs, dvec3(3, loopy, 0));
+        ltc.set_seed(42);
+
+        double yjump = loopy * cs;
+        for (double y = 0; y < yjump; y += 7) {
+            assert(seam(ltc, false, 200, y, 0, yjump, 0) < 1e-9);
+        }
+
+        // x loops after 3 cells, so pixel x and x + 3 * cs are equal
+        simplex_octave noise(ltc, 200, false);
+        std::vector<double> row(200);
+        noise.row(17, 0, row.data());
+        for (size_t x = 0; x + 75 < row.size(); x++) {
+            assert(std::fabs(row[x] - row[x + 75]) < 1e-9);
+        }
+    }
+
+    lattice3 ltc(cs, dvec3(4, 3, 5));
+    ltc.set_seed(7);
+    for (double y = 0; y < 3 * cs; y += 5) {
+        assert(seam(ltc, true, 150, y, 3.25, 3 * cs, 0) < 1e-9);
+        assert(seam(ltc, true, 150, y, 3.25, 0, 5 * cs) < 1e-9);
+    }
+
+    // the noise is continuous, neighbouring pixels of a large cell are close
+    lattice3 wide(400, dvec3(0, 0, 0));
+    wide.set_seed(1);
+    for (bool threed : {false, true}) {
+        simplex_octave noise(wide, 1000, threed);
+        std::vector<double> row(1000);
+        for (double y = 0; y < 800; y += 13) {
+            noise.row(y, 91, row.data());
+            for (size_t x = 1; x < row.size(); x++) {
+                assert(std::fabs(row[x] - row[x - 1]) < 0.05);
+            }
+        }
+    }
+
+    std::cout << "all simplex tests passed" << std::endl;
+
+    return 0;
+}
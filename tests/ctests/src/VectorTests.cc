@@ -81,5 +81,40 @@ int main(int argc, char** argv) {
     std::cout << movcd << std::endl;
     assert(movcd[0] == 123.0f && movcd[1] == 2.0f && movcd[2] == 123.0f);
 
+    // float4/float2 may go through SSE, which has to match the plain per-element math exactly,
+    // including NaNs and signed zeros
+    std::cout << "sse: " << VEC_SSE << std::endl;
+    float nan = std::nanf("");
+    float4 a(1.5f, -0.0f, nan, -3.25f);
+    float4 b(0.0f, 0.0f, 2.0f, 7.0f);
+
+    float4 sums = a + b, diffs = a - b, prods = a * b, quots = b / a;
+    float4 scaled = a * 0.5f, shifted = 2.0f - a;
+    float4 maxed = float4::max(a, b), absed = float4::abs(a), clamped = a.clamp(-1.0f, 1.0f);
+    float4 lerped = float4::lerp(0.25f, a, b), steps = float4::step(b, a);
+    for (size_t i = 0; i < 4; i++) {
+        auto same = [](float x, float y) {
+            return (std::isnan(x) && std::isnan(y)) ||
+                   (x == y && std::signbit(x) == std::signbit(y));
+        };
+        assert(same(sums[i], a[i] + b[i]));
+        assert(same(diffs[i], a[i] - b[i]));
+        assert(same(prods[i], a[i] * b[i]));
+        assert(same(quots[i], b[i] / a[i]));
+        assert(same(scaled[i], a[i] * 0.5f));
+        assert(same(shifted[i], 2.0f - a[i]));
+        assert(same(maxed[i], std::max(a[i], b[i])));
+        assert(same(absed[i], std::abs(a[i])));
+        assert(same(clamped[i], std::clamp(a[i], -1.0f, 1.0f)));
+        assert(same(lerped[i], (b[i] - a[i]) * 0.25f + a[i]));
+        assert(same(steps[i], a[i] >= b[i] ? 1.0f : 0.0f));
+    }
+
+    float2 c(3.0f, -1.0f);
+    c *= float2(2.0f, 4.0f);
+    c += 1.0f;
+    assert(c[0] == 7.0f && c[1] == -3.0f);
+    assert(float2::max(c, float2(0.0f))[1] == 0.0f);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "voronoi.h"
+
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// find_nearest of voronoi.lua, first site wins ties
+static size_t brute_nearest(std::vector<double> const& xs, std::vector<double> const& ys,
+                            double x, double y, DISTANCE_FUNC distance_func) {
+    size_t nearest = 0;
+    double dist = distance_funcs[distance_func](x, y, 0, xs[0], ys[0], 0);
+    for (size_t i = 1; i < xs.size(); i++) {
+        double d = distance_funcs[distance_func](x, y, 0, xs[i], ys[i], 0);
+        if (dist > d) {
+            nearest = i;
+            dist = d;
+        }
+    }
+    return nearest;
+}
+
+static void check(std::vector<double> const& xs, std::vector<double> const& ys,
+                  std::mt19937& gen) {
+    std::uniform_real_distribution<double> pos(-80.0, 180.0);
+
+    for (DISTANCE_FUNC f : {EUCLIDIAN, MANHATTAN}) {
+        site_grid grid(xs, ys, f);
+
+        // pixels, including ones outside of the sites' bounding box
+        for (int i = 0; i < 3000; i++) {
+            double x = std::floor(pos(gen)), y = std::floor(pos(gen));
+            assert(grid.nearest(x, y) == brute_nearest(xs, ys, x, y, f));
+        }
+
+        // every site is its own nearest, unless an earlier one is at the same spot
+        for (size_t i = 0; i < xs.size(); i++) {
+            assert(grid.nearest(xs[i], ys[i]) == brute_nearest(xs, ys, xs[i], ys[i], f));
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> site(0.0, 100.0);
+
+    for (size_t n : {1, 2, 7, 50, 400}) {
+        std::vector<double> xs(n), ys(n);
+        for (size_t i = 0; i < n; i++) {
+            xs[i] = site(gen);
+            ys[i] = site(gen);
+        }
+        check(xs, ys, gen);
+
+        // whole positions, so that there are plenty of ties, and a repeated site
+        for (size_t i = 0; i < n; i++) {
+            xs[i] = std::round(xs[i] / 10) * 10;
+            ys[i] = std::round(ys[i] / 10) * 10;
+        }
+        xs.push_back(xs[0]);
+        ys.push_back(ys[0]);
+        check(xs, ys, gen);
+    }
+
+    // sites along a line
+    std::vector<double> xs(30, 42.0), ys(30);
+    for (size_t i = 0; i < ys.size(); i++) {
+        ys[i] = site(gen);
+    }
+    check(xs, ys, gen);
+
+    // a graph is the nearest site of every pixel, offset by left and top
+    site_grid grid({10.5, 60, 35}, {10, 20.25, 70}, EUCLIDIAN);
+    std::vector<double> graph(40 * 30);
+    voronoi_graph(grid, 40, 30, -5.5, 12, graph.data());
+    for (size_t y = 0; y < 30; y++) {
+        for (size_t x = 0; x < 40; x++) {
+            size_t nearest = grid.nearest(x - 5.5, y + 12.0);
+            assert(graph[y * 40 + x] == (double)(nearest + 1));
+        }
+    }
+
+    bool threw = false;
+    try {
+        site_grid empty({}, {}, EUCLIDIAN);
+    } catch (std::invalid_argument const&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "all voronoi tests passed" << std::endl;
+
+    return 0;
+}
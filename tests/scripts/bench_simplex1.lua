@@ -0,0 +1,56 @@
+local utils = require("utils")
+local libnoise = utils.try_load_dlib("libnoise")
+
+-- compares the native Perlin engine against simplex noise (through Fractal, with the same octaves)
+-- at the same output size. os.clock counts the time of every thread, so this is the total work
+-- rather than the wall time
+local width = 256
+local height = 256
+local cellsize = 32
+
+local cases = {
+    { dimensions = 2, frames = 1, octaves = 1 },
+    { dimensions = 2, frames = 1, octaves = 4 },
+    { dimensions = 3, frames = 32, octaves = 1 },
+    { dimensions = 3, frames = 32, octaves = 4 },
+}
+
+local function options(case)
+    return {
+        seed = 314159,
+        width = width,
+        height = height,
+        length = case.frames,
+        cellsize = cellsize,
+        octaves = case.octaves,
+        dimensions = case.dimensions,
+        movement = 2,
+        loops = { x = width / cellsize, y = height / cellsize, z = 2 },
+    }
+end
+
+-- best of 7 runs, so that one slow run doesn't decide
+local function time_ms(make)
+    local best = math.huge
+    for _=1, 7 do
+        local noise = make()
+        local t = utils.timer_start_ms()
+        noise:compute()
+        best = math.min(best, t())
+    end
+    return best
+end
+
+for _, case in ipairs(cases) do
+    local perlin = time_ms(function() return Perlin(options(case)) end)
+    local simplex = time_ms(function()
+        local opts = options(case)
+        opts.base = libnoise.BASE_NOISES.Simplex
+        opts.lacunarity = 2
+        opts.gain = 0.5
+        return Fractal(opts)
+    end)
+
+    print(string.format("%dD %dx%dx%d, %d octaves: perlin %.2f ms, simplex %.2f ms",
+        case.dimensions, width, height, case.frames, case.octaves, perlin, simplex))
+end